@@ -0,0 +1,259 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+// Measures the overhead of the policy machinery itself, i.e. what enabling
+// GTEST_POLICIES_APPEND_ALL_LISTENERS costs per allocation, per byte written
+// to std::cout and per test. Listeners are driven with the same sequence of
+// events as Google Test would, which isolates their cost from the cost of 
+// the framework itself. Results are printed and recorded as test properties.
+
+#include <gtest/gtest.h>
+#include <gtest/gtest-spi.h>
+
+#include <gtest_policies/gtest_policies.h>
+
+#include <chrono>   // std::chrono::steady_clock
+#include <cstdio>   // std::printf
+#include <iostream> // std::cout
+#include <memory>   // std::unique_ptr
+#include <vector>   // std::vector
+
+using namespace gtest_policies;
+using namespace gtest_policies::listener;
+
+namespace
+{
+	const std::size_t allocations = 200000u;
+	const std::size_t stream_bytes = 16u * 1024u * 1024u;
+
+	// Invokes func(i) n times and returns the average duration in nanoseconds
+	template<class Func>
+	double NanosecondsPerOp(std::size_t n, Func func)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		for (std::size_t i = 0; i < n; ++i)
+			func(i);
+		const auto end = std::chrono::steady_clock::now();
+		return static_cast<double>(std::chrono::duration_cast<
+			std::chrono::nanoseconds>(end - start).count()) / 
+			static_cast<double>(n);
+	}
+
+	void Report(const char* name, double ns, const char* unit)
+	{
+		std::printf("[ BENCHMARK] %-56s %10.2f ns/%s\n", name, ns, unit);
+		::testing::Test::RecordProperty(name, std::to_string(ns));
+	}
+
+	using Listeners = std::vector<std::unique_ptr<PolicyListener>>;
+
+	// Drives listeners through the events of Google Test up to the test body
+	class ListenerDriver
+	{
+	public:
+		explicit ListenerDriver(Listeners& listeners) 
+			: listeners_(listeners) 
+		{ }
+
+		void ProgramStart()
+		{
+			for (auto& listener : listeners_)
+				listener->OnTestProgramStart(*Instance());
+			for (auto& listener : listeners_)
+				listener->OnTestSuiteStart(*Instance()->current_test_suite());
+		}
+
+		void TestStart()
+		{
+			for (auto& listener : listeners_)
+				listener->OnTestStart(*Instance()->current_test_info());
+			gtest_policies::Apply();
+		}
+
+		void TestEnd()
+		{
+			// Google Test invokes end events in reverse order
+			for (auto it = listeners_.rbegin(); it != listeners_.rend(); ++it)
+				(*it)->OnTestEnd(*Instance()->current_test_info());
+		}
+
+		void ProgramEnd()
+		{
+			for (auto it = listeners_.rbegin(); it != listeners_.rend(); ++it)
+				(*it)->OnTestSuiteEnd(*Instance()->current_test_suite());
+			for (auto it = listeners_.rbegin(); it != listeners_.rend(); ++it)
+				(*it)->OnTestProgramEnd(*Instance());
+		}
+
+	private:
+		static ::testing::UnitTest* Instance()
+		{
+			return ::testing::UnitTest::GetInstance();
+		}
+
+		Listeners& listeners_;
+	};
+
+	// Same listeners as GTEST_POLICIES_APPEND_ALL_LISTENERS
+	Listeners AllListeners()
+	{
+		Listeners listeners;
+		listeners.emplace_back(new MemAllocPolicyListener());
+		listeners.emplace_back(new MemPeakPolicyListener());
+		listeners.emplace_back(new MemLeakPolicyListener());
+		listeners.emplace_back(new BlockingIoPolicyListener());
+		listeners.emplace_back(new LockPolicyListener());
+		listeners.emplace_back(new ThreadPolicyListener());
+		listeners.emplace_back(new StdOutPolicyListener());
+		listeners.emplace_back(new StdErrPolicyListener());
+		listeners.emplace_back(new ExecTimePolicyListener());
+		listeners.emplace_back(new ResourceUsagePolicyListener());
+		listeners.emplace_back(new PerfCounterPolicyListener());
+		return listeners;
+	}
+
+	void AllocateAndFree(std::size_t)
+	{
+		// Calling operator new directly prevents eliding the allocation
+		void* volatile ptr = ::operator new(64u);
+		::operator delete(ptr);
+	}
+
+	// Discards all output
+	class NullBuffer : public std::streambuf
+	{
+	protected:
+		std::streamsize xsputn(const char_type*, std::streamsize n) override
+		{
+			return n;
+		}
+
+		int_type overflow(int_type c) override
+		{
+			return traits_type::not_eof(c);
+		}
+	};
+
+	void WriteBytes(std::size_t chunk)
+	{
+		static const char data[64] = { 'x' };
+		for (std::size_t i = 0; i < stream_bytes; i += chunk)
+			std::cout.write(data, static_cast<std::streamsize>(chunk));
+	}
+
+	double NanosecondsPerByte(std::size_t chunk)
+	{
+		return NanosecondsPerOp(1u, [chunk](std::size_t) { 
+			WriteBytes(chunk); }) / static_cast<double>(stream_bytes);
+	}
+
+	void BenchmarkTrivialTests(const char* name, Listeners&& listeners, 
+		std::size_t tests)
+	{
+		ListenerDriver driver(listeners);
+		driver.ProgramStart();
+		const auto ns = NanosecondsPerOp(tests, [&driver](std::size_t) {
+			driver.TestStart();
+			driver.TestEnd();
+		});
+		driver.ProgramEnd();
+		Report(name, ns, "test");
+	}
+}
+
+TEST(Benchmark, operator_new_delete)
+{
+	Report("operator new/delete, no policy applied", 
+		NanosecondsPerOp(allocations, AllocateAndFree), "op");
+
+	Listeners listeners;
+	listeners.emplace_back(new MemAllocPolicyListener());
+	listeners.emplace_back(new MemPeakPolicyListener());
+	listeners.emplace_back(new MemLeakPolicyListener());
+	ListenerDriver driver(listeners);
+	dynamic_memory_allocation.Grant();
+	driver.ProgramStart();
+
+	driver.TestStart();
+	Report("operator new/delete, memory policies granted",
+		NanosecondsPerOp(allocations, AllocateAndFree), "op");
+	driver.TestEnd();
+
+	dynamic_memory_allocation.Deny();
+	dynamic_memory_allocation.SetBudget(unlimited, unlimited);
+	driver.TestStart();
+	Report("operator new/delete, dynamic_memory_allocation denied",
+		NanosecondsPerOp(allocations, AllocateAndFree), "op");
+	driver.TestEnd();
+
+	peak_heap_usage.Deny();
+	peak_heap_usage.SetBudget(unlimited, unlimited);
+	memory_leaks.Deny();
+	memory_leaks.SetBudget(unlimited, unlimited);
+	driver.TestStart();
+	Report("operator new/delete, all memory policies denied",
+		NanosecondsPerOp(allocations, AllocateAndFree), "op");
+	driver.TestEnd();
+
+	dynamic_memory_allocation.SetBudget(0u, 0u);
+	peak_heap_usage.Grant();
+	memory_leaks.Grant();
+	driver.TestStart();
+	Report("operator new/delete, dynamic_memory_allocation violated",
+		NanosecondsPerOp(allocations, AllocateAndFree), "op");
+	Report("PolicyContext::MarkAsViolated",
+		NanosecondsPerOp(allocations, [](std::size_t) { 
+			dynamic_memory_allocation.MarkAsViolated(); }), "op");
+	EXPECT_NONFATAL_FAILURE(driver.TestEnd(), "Policy violation: ");
+
+	driver.ProgramEnd();
+	dynamic_memory_allocation.Grant();
+}
+
+TEST(Benchmark, counting_stream_buffer_filter)
+{
+	NullBuffer null_buffer;
+	auto original = std::cout.rdbuf(&null_buffer);
+
+	Report("std::cout, 1 byte writes", NanosecondsPerByte(1u), "byte");
+	Report("std::cout, 64 byte writes", NanosecondsPerByte(64u), "byte");
+	{
+		// Listener filters the null buffer installed above
+		Listeners listeners;
+		listeners.emplace_back(new StdOutPolicyListener());
+		ListenerDriver driver(listeners);
+		standard_output.Deny();
+		standard_output.SetBudget(unlimited, unlimited);
+		driver.ProgramStart();
+		driver.TestStart();
+		Report("std::cout filtered, 1 byte writes", 
+			NanosecondsPerByte(1u), "byte");
+		Report("std::cout filtered, 64 byte writes", 
+			NanosecondsPerByte(64u), "byte");
+		driver.TestEnd();
+		driver.ProgramEnd();
+	}
+
+	std::cout.rdbuf(original);
+}
+
+TEST(Benchmark, listeners_per_trivial_test)
+{
+	const std::size_t suites[] = { 10000u, 100000u };
+	for (const auto tests : suites)
+	{
+		const auto prefix = std::to_string(tests) + " trivial tests, ";
+		BenchmarkTrivialTests((prefix + "no listeners").c_str(), 
+			Listeners(), tests);
+
+		Listeners single;
+		single.emplace_back(new MemAllocPolicyListener());
+		BenchmarkTrivialTests((prefix + "1 listener").c_str(), 
+			std::move(single), tests);
+
+		auto all = AllListeners();
+		const auto name = prefix + std::to_string(all.size()) + " listeners";
+		BenchmarkTrivialTests(name.c_str(), std::move(all), tests);
+	}
+}
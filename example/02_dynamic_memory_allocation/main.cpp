@@ -53,3 +53,12 @@ TEST(example_01_dynamic_memory_allocation,
 	EXPECT_EQ(*ptr, 3);
 }
 
+
+TEST(example_01_dynamic_memory_allocation,
+	attempting_to_allocate_within_budget_is_ok)
+{
+	gtest_policies::Apply(); // Required if not using fixture
+	gtest_policies::dynamic_memory_allocation.SetBudget(1);
+	auto ptr = std::make_unique<int>(3);
+	EXPECT_EQ(*ptr, 3);
+}
@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////
+// gtest-policies
+// Example 04 - Execution Time
+//
+// Basic Google Test example showcasing execution time policies.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <gtest/gtest.h>
+#include <gtest_policies/gtest_policies.h>
+
+#include <chrono>
+#include <thread>
+
+int main(int argc, char **argv)
+{
+	// Deny exceeding 10 ms wall time per test in program scope. The execution
+	// time policy is granted by default.
+	gtest_policies::execution_time.Deny();
+	gtest_policies::execution_time.SetBudget(std::chrono::milliseconds(10));
+
+	// Initialize Google Test as usual
+	::testing::InitGoogleTest(&argc, argv);
+	
+	// Add policy listener to enable detection of policy violations...
+	// ...or just GTEST_POLICIES_APPEND_ALL_LISTENERS for simplicity
+	::testing::UnitTest::GetInstance()->listeners().Append(
+		new gtest_policies::listener::ExecTimePolicyListener());
+
+	// Run Google Test as usual
+	return RUN_ALL_TESTS();
+}
+
+TEST(example_04_execution_time,
+	exceeding_wall_time_budget_will_fail_test)
+{
+	gtest_policies::Apply(); // Required if not using fixture
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+}
+
+TEST(example_04_execution_time,
+	exceeding_cpu_time_budget_will_fail_test)
+{
+	gtest_policies::Apply(); // Required if not using fixture
+	gtest_policies::execution_time.SetBudget(
+		std::chrono::nanoseconds::max(), std::chrono::milliseconds(1));
+	const auto end = std::chrono::steady_clock::now() + 
+		std::chrono::milliseconds(20);
+	while (std::chrono::steady_clock::now() < end) { }
+}
+
+TEST(example_04_execution_time,
+	executing_within_budget_is_ok)
+{
+	gtest_policies::Apply(); // Required if not using fixture
+	std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+TEST(example_04_execution_time,
+	exceeding_budget_when_policy_is_granted_is_ok)
+{
+	gtest_policies::Apply(); // Required if not using fixture
+	gtest_policies::execution_time.Grant();
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+}
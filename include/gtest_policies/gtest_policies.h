@@ -14,16 +14,51 @@
 #define GTEST_POLICIES_H
 
 #include <gtest/gtest.h> // Google Test
+#include <atomic>        // std::atomic
+#include <chrono>        // std::chrono::nanoseconds
+#include <cstddef>       // std::size_t
+#include <cstdint>       // std::uint64_t
+#include <limits>        // std::numeric_limits
 #include <memory>        // std::unique_ptr
+#include <string>        // std::string
+#include <type_traits>   // std::true_type
+
+// Polymorphic memory resources require C++17
+#if (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) || __cplusplus >= 201703L
+  #if defined(__has_include)
+    #if __has_include(<memory_resource>)
+      #define GTEST_POLICY_MEMORY_RESOURCE_AVAILABLE
+      #include <memory_resource> // std::pmr::memory_resource
+    #endif // __has_include(<memory_resource>)
+  #endif // defined(__has_include)
+#endif // C++17
 
 #ifndef GTEST_POLICIES_APPEND_ALL_LISTENERS
 #define GTEST_POLICIES_APPEND_ALL_LISTENERS \
 	::testing::UnitTest::GetInstance()->listeners().Append( \
 		new gtest_policies::listener::MemAllocPolicyListener()); \
+	::testing::UnitTest::GetInstance()->listeners().Append( \
+		new gtest_policies::listener::MemPeakPolicyListener()); \
+	::testing::UnitTest::GetInstance()->listeners().Append( \
+		new gtest_policies::listener::MemLeakPolicyListener()); \
+	::testing::UnitTest::GetInstance()->listeners().Append( \
+		new gtest_policies::listener::UpstreamAllocPolicyListener()); \
+	::testing::UnitTest::GetInstance()->listeners().Append( \
+		new gtest_policies::listener::BlockingIoPolicyListener()); \
+	::testing::UnitTest::GetInstance()->listeners().Append( \
+		new gtest_policies::listener::LockPolicyListener()); \
+	::testing::UnitTest::GetInstance()->listeners().Append( \
+		new gtest_policies::listener::ThreadPolicyListener()); \
 	::testing::UnitTest::GetInstance()->listeners().Append( \
 		new gtest_policies::listener::StdOutPolicyListener()); \
 	::testing::UnitTest::GetInstance()->listeners().Append( \
-		new gtest_policies::listener::StdErrPolicyListener())
+		new gtest_policies::listener::StdErrPolicyListener()); \
+	::testing::UnitTest::GetInstance()->listeners().Append( \
+		new gtest_policies::listener::ExecTimePolicyListener()); \
+	::testing::UnitTest::GetInstance()->listeners().Append( \
+		new gtest_policies::listener::ResourceUsagePolicyListener()); \
+	::testing::UnitTest::GetInstance()->listeners().Append( \
+		new gtest_policies::listener::PerfCounterPolicyListener())
 #endif // GTEST_POLICIES_APPEND_ALL_LISTENERS
 
 // Convenience macro to generate a main program entry point with policy 
@@ -33,6 +68,7 @@
 #define GTEST_POLICIES_MAIN \
 int main(int argc, char **argv) \
 { \
+	gtest_policies::ParseFlags(&argc, argv); \
 	::testing::InitGoogleTest(&argc, argv); \
 	GTEST_POLICIES_APPEND_ALL_LISTENERS; \
 	return RUN_ALL_TESTS(); \
@@ -47,6 +83,93 @@ namespace listener {
  class PolicyListener;
 }
 
+// Budget limit value representing no limit.
+constexpr std::uint64_t unlimited = std::numeric_limits<std::uint64_t>::max();
+
+namespace detail {
+
+// Quantities measured by a policy monitor while a policy is denied, e.g. 
+// number of allocations and number of bytes allocated. The meaning of each
+// metric is defined by the monitor. Also used to express the budget of a
+// policy, i.e. the per-test limit of each metric.
+struct PolicyUsage
+{
+	static const std::size_t max_metrics = 4u;
+	std::uint64_t metrics[max_metrics];
+};
+
+// Budget limit formatted for reporting, e.g. "3" or "unlimited".
+struct Limit
+{
+	std::uint64_t value;
+};
+
+inline Limit FormatLimit(std::uint64_t limit) noexcept
+{
+	Limit result = { limit };
+	return result;
+}
+
+// Fixed capacity text buffer used to format policy violation reports 
+// without allocating memory. Text exceeding the capacity is truncated.
+class ReportBuffer
+{
+public:
+	static const std::size_t capacity = 8192u;
+
+	ReportBuffer() noexcept;
+	ReportBuffer(const ReportBuffer&) = delete;
+	ReportBuffer& operator=(const ReportBuffer&) = delete;
+
+	void Clear() noexcept;
+	void Append(const char* text, std::size_t length) noexcept;
+
+	const char* c_str() const noexcept;
+	std::size_t size() const noexcept;
+	bool truncated() const noexcept;
+
+	ReportBuffer& operator<<(const char* text) noexcept;
+	ReportBuffer& operator<<(const std::string& text) noexcept;
+	ReportBuffer& operator<<(char c) noexcept;
+	ReportBuffer& operator<<(unsigned long long value) noexcept;
+	ReportBuffer& operator<<(unsigned long value) noexcept;
+	ReportBuffer& operator<<(unsigned int value) noexcept;
+	ReportBuffer& operator<<(long long value) noexcept;
+	ReportBuffer& operator<<(long value) noexcept;
+	ReportBuffer& operator<<(int value) noexcept;
+	ReportBuffer& operator<<(Limit limit) noexcept;
+
+private:
+	char buffer_[capacity];
+	std::size_t size_;
+	bool truncated_;
+};
+
+} // namespace gtest_policies::detail
+
+///////////////////////////////////////////////////////////////////////////////
+// ThreadScope
+///////////////////////////////////////////////////////////////////////////////
+
+// Threads whose activity is accounted to the running test by a policy.
+enum class ThreadScope
+{
+	// Any thread of the process (default).
+	all_threads,
+
+	// Only the thread running the test, i.e. the thread which applied the 
+	// policy or denied it during the test, hence activity of worker threads
+	// is not accounted. Equivalent to a thread local deny state.
+	current_thread,
+
+	// The thread running the test and threads created by it, directly or 
+	// indirectly, after applying the policy. Threads existing before, e.g. 
+	// background loggers or thread pools warmed up by earlier tests, are not
+	// accounted. Requires thread creation hooks (glibc), otherwise equivalent
+	// to current_thread.
+	test_threads
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // PolicyContext
 ///////////////////////////////////////////////////////////////////////////////
@@ -55,7 +178,8 @@ class PolicyContext {
  public:
   explicit PolicyContext(listener::PolicyListener* listener = nullptr,
 	  bool is_denied_by_default = true) noexcept;
-  PolicyContext(const PolicyContext&) noexcept = default;
+  PolicyContext(const PolicyContext& other) noexcept;
+  PolicyContext& operator=(const PolicyContext& other) noexcept;
   ~PolicyContext() noexcept = default;
 
   void Deny() noexcept;
@@ -64,6 +188,26 @@ class PolicyContext {
 
   void SetDenied(bool denied) noexcept;
 
+  // Permits up to count occurrences and bytes in total per test while the
+  // policy is denied, e.g. number of allocations and bytes allocated. 
+  // The budget is inherited and reverted in the same way as Deny()/Grant().
+  // The default budget is zero, i.e. any occurrence violates the policy.
+  void SetBudget(std::uint64_t count, 
+	  std::uint64_t bytes = unlimited) noexcept;
+  void SetBudget(const detail::PolicyUsage& budget) noexcept;
+  void SetLimit(std::size_t metric, std::uint64_t limit) noexcept;
+  std::uint64_t Limit(std::size_t metric) const noexcept;
+  const detail::PolicyUsage& Budget() const noexcept;
+
+  // Restricts the threads accounted while the policy is denied, see 
+  // ThreadScope. The scope is inherited and reverted in the same way as 
+  // Deny()/Grant(). Honored by policies detecting activity via hooks, i.e.
+  // dynamic_memory_allocation, memory_leaks, blocking_io, lock_acquisition
+  // and thread_creation. Other policies measure the thread running the test
+  // or the process as a whole.
+  void SetThreadScope(ThreadScope scope) noexcept;
+  ThreadScope Scope() const noexcept;
+
   void Reset() noexcept;
 
   bool IsDenied() const noexcept;
@@ -74,20 +218,77 @@ private:
   friend gtest_policies::listener::PolicyListener;
 
   listener::PolicyListener* listener_;
-  bool denied_;
+  detail::PolicyUsage budget_;
+  std::atomic<bool> denied_;
+  std::atomic<ThreadScope> scope_;
   bool denied_by_default_;
 };
 
+// Context of a time based policy, i.e. execution_time, whose budget is given
+// as durations. Hides the count based budgets, hence a duration may not be 
+// given as budget of any other policy.
+class TimePolicyContext : public PolicyContext {
+ public:
+  explicit TimePolicyContext(listener::PolicyListener* listener = nullptr,
+	  bool is_denied_by_default = false) noexcept;
+
+  // Permits up to wall_time and cpu_time per test while the policy is denied.
+  void SetBudget(std::chrono::nanoseconds wall_time,
+	  std::chrono::nanoseconds cpu_time = 
+		  std::chrono::nanoseconds::max()) noexcept;
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // Test policies
 ///////////////////////////////////////////////////////////////////////////////
 
 extern PolicyContext dynamic_memory_allocation;
+extern PolicyContext peak_heap_usage; // granted by default
+extern PolicyContext memory_leaks;    // granted by default
+extern PolicyContext blocking_io;     // granted by default
+extern PolicyContext lock_acquisition; // granted by default
+extern PolicyContext thread_creation; // granted by default
 extern PolicyContext standard_output;
 extern PolicyContext standard_error;
-
+extern TimePolicyContext execution_time; // granted by default
+extern PolicyContext resource_usage; // granted by default
+extern PolicyContext hardware_counters; // granted by default
+extern PolicyContext upstream_allocation;
+
+// Applies all policies having an attached listener, i.e. starts monitoring
+// denied policies. Custom policies are applied by attaching a listener for 
+// them, see PolicyListener.
 void Apply() noexcept;
 
+// Exports the measurements of all policy listeners, one record per test, 
+// when the test program ends. output is "json:<path>" or "csv:<path>", or 
+// empty to disable export. Overrides environment variable 
+// GTEST_POLICIES_METRICS which has the same format. Only metrics of policies
+// denied at some point during a test are measured, hence use a budget of 
+// unlimited to measure without enforcing. Discards any recorded metrics.
+void SetMetricsOutput(const char* output);
+
+// Compares the metrics of each test, see SetMetricsOutput(), against a 
+// baseline loaded from the CSV metrics file path when the test program 
+// starts. A test fails if a metric exceeds its baseline value by more than 
+// tolerance, a fraction of the baseline value, e.g. 0.1 permits 10% more. 
+// If rewrite, tests are not compared and the baseline is instead rewritten 
+// with the metrics of the tests run when the test program ends, keeping the
+// baseline of tests not run. An empty path disables comparison. Overrides 
+// environment variables GTEST_POLICIES_BASELINE, 
+// GTEST_POLICIES_BASELINE_TOLERANCE and GTEST_POLICIES_REWRITE_BASELINE.
+void SetBaseline(const char* path, double tolerance = 0.1, 
+	bool rewrite = false);
+
+// Parses and removes flags of this library from argv, i.e. 
+// --gtest_policies_metrics=<output> with output as for SetMetricsOutput(),
+// --gtest_policies_baseline=<path>, 
+// --gtest_policies_baseline_tolerance=<tolerance> and 
+// --gtest_policies_rewrite_baseline as for SetBaseline().
+// Must be invoked before ::testing::InitGoogleTest() since Google Test 
+// treats unrecognized flags having its prefix as a request for help.
+void ParseFlags(int* argc, char** argv);
+
 ///////////////////////////////////////////////////////////////////////////////
 // Test
 ///////////////////////////////////////////////////////////////////////////////
@@ -111,6 +312,262 @@ protected:
 	}
 };
 
+// Tag types identifying policies at compile time, see TestWith.
+namespace tag {
+
+#define GTEST_POLICY_TAG(name) \
+	struct name \
+	{ \
+		static PolicyContext& Context() noexcept \
+		{ \
+			return gtest_policies::name; \
+		} \
+	}
+
+GTEST_POLICY_TAG(dynamic_memory_allocation);
+GTEST_POLICY_TAG(peak_heap_usage);
+GTEST_POLICY_TAG(memory_leaks);
+GTEST_POLICY_TAG(blocking_io);
+GTEST_POLICY_TAG(lock_acquisition);
+GTEST_POLICY_TAG(thread_creation);
+GTEST_POLICY_TAG(standard_output);
+GTEST_POLICY_TAG(standard_error);
+GTEST_POLICY_TAG(execution_time);
+GTEST_POLICY_TAG(resource_usage);
+GTEST_POLICY_TAG(hardware_counters);
+GTEST_POLICY_TAG(upstream_allocation);
+
+#undef GTEST_POLICY_TAG
+
+} // namespace gtest_policies::tag
+
+// Fixture applying only the policies identified by Tags when a test starts, 
+// e.g. TestWith<tag::dynamic_memory_allocation, tag::blocking_io>, instead of
+// applying every registered policy as Test does. This is a runtime subset: 
+// policies not selected are not monitored by tests of the fixture, even if
+// denied, but their hooks remain linked and are still entered, returning 
+// after checking that monitoring is off. Hooks are process-wide interposers
+// and may only be removed when building the library, e.g. by defining 
+// GTEST_POLICY_DISABLE_MALLOC_HOOKS.
+template<class... Tags>
+class TestWith : public ::testing::Test
+{
+public:
+	virtual ~TestWith() = default;
+protected:
+	TestWith() = default;
+
+	virtual void SetUp() override
+	{
+		::testing::Test::SetUp();
+		const int expand[] = { 0, (Tags::Context().Apply(), 0)... };
+		(void)expand;
+	}
+
+	virtual void TearDown() override
+	{
+		::testing::Test::TearDown();
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// counting_allocator
+///////////////////////////////////////////////////////////////////////////////
+
+// Allocations made via counting_allocator instances sharing the stats, 
+// typically the allocators of a single container. Not thread-safe, i.e. 
+// shared by containers accessed from one thread at a time.
+struct allocation_stats
+{
+	std::size_t allocations = 0u;       // calls to allocate
+	std::size_t deallocations = 0u;     // calls to deallocate
+	std::size_t array_allocations = 0u; // calls to allocate with n > 1
+	std::size_t allocated_bytes = 0u;
+	std::size_t deallocated_bytes = 0u;
+	std::size_t peak_bytes = 0u;        // highest live bytes
+	std::size_t live_baseline = 0u;     // live bytes at last reset
+
+	std::size_t live_bytes() const noexcept
+	{
+		return live_baseline + allocated_bytes - deallocated_bytes;
+	}
+
+	// Clears counters, e.g. after populating a container ahead of the 
+	// section of interest. Live bytes are kept, and peak bytes restart from
+	// them.
+	void reset() noexcept
+	{
+		const auto live = live_bytes();
+		*this = allocation_stats();
+		live_baseline = live;
+		peak_bytes = live;
+	}
+};
+
+// Allocator forwarding to Upstream and recording each allocation into an 
+// allocation_stats object, for asserting on the allocations of a single 
+// container, e.g. that a std::vector grows exactly once after reserve() or 
+// that a std::unordered_map does not rehash, i.e. allocates no new bucket 
+// array, during a loop. Rebound copies, e.g. for the nodes and buckets of a 
+// node based container, record into the same stats. The stats follow the
+// allocator on container copy assignment, move assignment and swap, hence 
+// a deallocation is always recorded into the stats of its allocation.
+template<class T, class Upstream = std::allocator<T>>
+class counting_allocator
+{
+	using upstream_traits = std::allocator_traits<Upstream>;
+
+public:
+	using value_type = T;
+	using upstream_type = Upstream;
+	using propagate_on_container_copy_assignment = std::true_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+	using is_always_equal = std::false_type;
+
+	template<class U>
+	struct rebind
+	{
+		using other = counting_allocator<U, 
+			typename upstream_traits::template rebind_alloc<U>>;
+	};
+
+	explicit counting_allocator(allocation_stats& stats, 
+		const Upstream& upstream = Upstream()) noexcept :
+		stats_(&stats),
+		upstream_(upstream)
+	{ }
+
+	template<class U, class UpstreamU>
+	counting_allocator(
+		const counting_allocator<U, UpstreamU>& other) noexcept :
+		stats_(other.stats_),
+		upstream_(other.upstream_)
+	{ }
+
+	T* allocate(std::size_t n)
+	{
+		T* p = upstream_traits::allocate(upstream_, n);
+		const auto bytes = n * sizeof(T);
+		++stats_->allocations;
+		if (n > 1u)
+			++stats_->array_allocations;
+		stats_->allocated_bytes += bytes;
+		if (stats_->live_bytes() > stats_->peak_bytes)
+			stats_->peak_bytes = stats_->live_bytes();
+		return p;
+	}
+
+	void deallocate(T* p, std::size_t n) noexcept
+	{
+		++stats_->deallocations;
+		stats_->deallocated_bytes += n * sizeof(T);
+		upstream_traits::deallocate(upstream_, p, n);
+	}
+
+	allocation_stats& stats() const noexcept
+	{
+		return *stats_;
+	}
+
+	const Upstream& upstream() const noexcept
+	{
+		return upstream_;
+	}
+
+private:
+	allocation_stats* stats_;
+	Upstream upstream_;
+
+	template<class U, class UpstreamU>
+	friend class counting_allocator;
+};
+
+template<class T, class UpstreamT, class U, class UpstreamU>
+bool operator==(const counting_allocator<T, UpstreamT>& lhs,
+	const counting_allocator<U, UpstreamU>& rhs) noexcept
+{
+	return &lhs.stats() == &rhs.stats() && lhs.upstream() == rhs.upstream();
+}
+
+template<class T, class UpstreamT, class U, class UpstreamU>
+bool operator!=(const counting_allocator<T, UpstreamT>& lhs,
+	const counting_allocator<U, UpstreamU>& rhs) noexcept
+{
+	return !(lhs == rhs);
+}
+
+#ifdef GTEST_POLICY_MEMORY_RESOURCE_AVAILABLE
+
+///////////////////////////////////////////////////////////////////////////////
+// policy_memory_resource
+///////////////////////////////////////////////////////////////////////////////
+
+// Memory resource forwarding to an upstream resource, where each allocation 
+// from the upstream is accounted to the upstream_allocation policy, see 
+// UpstreamAllocPolicyListener. Used as the upstream of a pool or arena 
+// resource, e.g. std::pmr::monotonic_buffer_resource, it detects when the 
+// pool falls back to its upstream, which the dynamic_memory_allocation 
+// policy cannot distinguish from allocations served by the pool.
+class policy_memory_resource : public std::pmr::memory_resource
+{
+public:
+	explicit policy_memory_resource(std::pmr::memory_resource* upstream = 
+		std::pmr::get_default_resource()) noexcept;
+
+	policy_memory_resource(const policy_memory_resource&) = delete;
+	policy_memory_resource& operator=(const policy_memory_resource&) = delete;
+
+	std::pmr::memory_resource* upstream_resource() const noexcept;
+
+protected:
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+	void do_deallocate(void* p, std::size_t bytes, 
+		std::size_t alignment) override;
+	bool do_is_equal(
+		const std::pmr::memory_resource& other) const noexcept override;
+
+private:
+	std::pmr::memory_resource* upstream_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// policy_arena_resource
+///////////////////////////////////////////////////////////////////////////////
+
+// Monotonic arena allocating from a caller provided buffer only. Once the 
+// buffer is exhausted the arena falls back to upstream via a 
+// policy_memory_resource, hence denying upstream_allocation asserts that a
+// component allocating from the arena never hits the upstream, typically 
+// the global heap. Memory is released when the arena is destroyed or 
+// release() is invoked.
+class policy_arena_resource : public std::pmr::memory_resource
+{
+public:
+	policy_arena_resource(void* buffer, std::size_t size,
+		std::pmr::memory_resource* upstream = 
+			std::pmr::get_default_resource());
+
+	policy_arena_resource(const policy_arena_resource&) = delete;
+	policy_arena_resource& operator=(const policy_arena_resource&) = delete;
+
+	void release();
+	std::pmr::memory_resource* upstream_resource() const noexcept;
+
+protected:
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+	void do_deallocate(void* p, std::size_t bytes, 
+		std::size_t alignment) override;
+	bool do_is_equal(
+		const std::pmr::memory_resource& other) const noexcept override;
+
+private:
+	policy_memory_resource upstream_;
+	std::pmr::monotonic_buffer_resource arena_;
+};
+
+#endif // GTEST_POLICY_MEMORY_RESOURCE_AVAILABLE
+
 ///////////////////////////////////////////////////////////////////////////////
 // PolicyListener
 ///////////////////////////////////////////////////////////////////////////////
@@ -123,6 +580,24 @@ public:
 	virtual ~PolicyMonitor() { }
 	virtual void Start() = 0;
 	virtual bool Stop() = 0;
+
+	// Usage measured between the most recent calls to Start() and Stop().
+	// Only invoked if Stop() reported activity. Monitors not measuring any
+	// quantities report a single occurrence.
+	virtual PolicyUsage Usage() const 
+	{ 
+		PolicyUsage usage = { { 1u } };
+		return usage;
+	}
+
+	// Invoked when a new test starts to discard any details recorded 
+	// during the previous test.
+	virtual void Reset() { }
+
+	// Invoked when a test in which the policy was applied ends, after Stop()
+	// if denied. Monitors evaluating state at the end of the test, rather 
+	// than activity while denied, return whether there is usage to evaluate.
+	virtual bool Finish() { return false; }
 };
 
 } // namespace gtest_policies::detail
@@ -133,6 +608,9 @@ public:
 
 namespace listener {
 
+// Enforces a policy using a monitor. Custom policies are added by deriving
+// from PolicyListener with a custom PolicyContext and monitor, the policy is
+// registered for gtest_policies::Apply() when the test program starts.
 class PolicyListener : public ::testing::TestEventListener {
 public:
 	PolicyListener(PolicyContext& policy,
@@ -180,25 +658,58 @@ public:
 	const PolicyContext& Policy() const noexcept;
 	PolicyContext& Policy() noexcept;
 
+	// Usage accumulated while denied during the current or most recent test.
+	const detail::PolicyUsage& Usage() const noexcept;
+
 protected:
 	//virtual void OnTestPartPolicyViolation() {};
 	virtual void OnPolicyViolation() {};
 
+	// Returns the name of metric in exported per-test metrics, or nullptr 
+	// if the metric is not exported, see SetMetricsOutput().
+	virtual const char* MetricName(std::size_t /*metric*/) const noexcept 
+	{ 
+		return nullptr; 
+	}
+
+	// Returns the cleared, preallocated buffer for formatting a violation 
+	// report. When OnPolicyViolation() is invoked the monitors of all 
+	// registered policies have been stopped, hence reporting is never 
+	// accounted to the test.
+	detail::ReportBuffer& ViolationReport() noexcept;
+
 private:
 	void Apply();
 	void ReportViolation();
 	void StopAndEvaluate();
-	void RestorePolicy(bool Deny) noexcept;
+	void Evaluate();
+	void Conclude();
+	static void ConcludeAll();
+	void RestorePolicy(bool Deny, const detail::PolicyUsage& budget,
+		ThreadScope scope) noexcept;
 	void OnPolicyChangeDuringTest(bool Deny) noexcept;
+	void RecordMetrics(const ::testing::TestInfo& test_info, bool has_failure);
 
 	std::unique_ptr<detail::PolicyMonitor> monitor_;
 	PolicyContext& policy_;
+	detail::ReportBuffer report_;
+	detail::PolicyUsage usage_;
+	detail::PolicyUsage global_budget_;
+	detail::PolicyUsage program_budget_;
+	detail::PolicyUsage stored_budget_;
+	ThreadScope global_scope_;
+	ThreadScope program_scope_;
+	ThreadScope stored_scope_;
 	bool global_policy_;
 	bool program_policy_;
 	bool stored_policy_;
-	bool violated_;
-	bool in_test_scope_;
-	bool applied_;
+
+	// Accessed by hooks on any thread
+	std::atomic<bool> violated_;
+	std::atomic<bool> in_test_scope_;
+	std::atomic<bool> applied_;
+	bool concluded_;
+	bool monitored_;
 
 	friend gtest_policies::PolicyContext;
 };
@@ -207,12 +718,158 @@ private:
 // MemAllocPolicyListener
 ///////////////////////////////////////////////////////////////////////////////
 
+// Number of allocations (counts) and requested bytes (bytes) per log2 size 
+// class while dynamic memory allocation is denied. Size class k holds 
+// allocations of [2^k, 2^(k+1)) bytes, except that size class 0 also holds 
+// zero sized allocations and the last size class has no upper bound.
+struct AllocationHistogram
+{
+	static const std::size_t size_classes = 32u;
+
+	std::uint64_t counts[size_classes];
+	std::uint64_t bytes[size_classes];
+};
+
+// Besides enforcing the policy, collects a size class histogram of the 
+// allocations made by each test while denied. Non-empty histograms are 
+// attached to the test result as property "allocation_histogram" and, if 
+// histogram_file is given or the GTEST_POLICIES_ALLOCATION_HISTOGRAM 
+// environment variable is set, written to that file as JSON when the test 
+// program ends.
 class MemAllocPolicyListener : public PolicyListener
 {
 public:
-	MemAllocPolicyListener();
+	explicit MemAllocPolicyListener(const char* histogram_file = nullptr);
+
+	void OnTestEnd(const ::testing::TestInfo& test_info) override;
+	void OnTestProgramEnd(const ::testing::UnitTest& unit_test) override;
+
+	// Returns the histogram of the most recently ended test.
+	const AllocationHistogram& Histogram() const noexcept;
+
+protected:
+	void OnPolicyViolation() override;
+	const char* MetricName(std::size_t metric) const noexcept override;
+
+private:
+	AllocationHistogram histogram_;
+	std::string histogram_file_;
+	std::string histogram_json_; // records of tests written to file
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// MemPeakPolicyListener
+///////////////////////////////////////////////////////////////////////////////
+
+// Tracks the peak number of live heap blocks (metric 0) and live heap bytes
+// (metric 1) while the peak_heap_usage policy is denied, relative to when 
+// the policy was applied, i.e. memory freed during the test is subtracted.
+class MemPeakPolicyListener : public PolicyListener
+{
+public:
+	MemPeakPolicyListener();
+protected:
+	void OnPolicyViolation() override;
+	const char* MetricName(std::size_t metric) const noexcept override;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// MemLeakPolicyListener
+///////////////////////////////////////////////////////////////////////////////
+
+// Tracks heap blocks allocated while the memory_leaks policy is denied and 
+// reports blocks (metric 0) and bytes (metric 1) not freed at the end of the
+// test. Blocks are tracked until the end of the test even if the policy is 
+// granted in between, i.e. freeing them while granted is not a leak.
+class MemLeakPolicyListener : public PolicyListener
+{
+public:
+	MemLeakPolicyListener();
+protected:
+	void OnPolicyViolation() override;
+	const char* MetricName(std::size_t metric) const noexcept override;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// UpstreamAllocPolicyListener
+///////////////////////////////////////////////////////////////////////////////
+
+// Detects allocations from the upstream of policy_memory_resource and 
+// policy_arena_resource instances while the upstream_allocation policy is 
+// denied. Metric 0 is number of upstream allocations and metric 1 is number
+// of bytes allocated from the upstream. Deallocations are not accounted.
+class UpstreamAllocPolicyListener : public PolicyListener
+{
+public:
+	UpstreamAllocPolicyListener();
+protected:
+	void OnPolicyViolation() override;
+	const char* MetricName(std::size_t metric) const noexcept override;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BlockingIoPolicyListener
+///////////////////////////////////////////////////////////////////////////////
+
+// Detects calls to open, read, write, fsync, send, recv and poll family 
+// functions while the blocking_io policy is denied. Metric 0 is number of 
+// calls and metric 1 is number of bytes transferred.
+class BlockingIoPolicyListener : public PolicyListener
+{
+public:
+	BlockingIoPolicyListener();
 protected:
 	void OnPolicyViolation() override;
+	const char* MetricName(std::size_t metric) const noexcept override;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// LockPolicyListener
+///////////////////////////////////////////////////////////////////////////////
+
+// Detects mutex, spin lock and rwlock acquisitions, futex waits and 
+// condition variable waits while the lock_acquisition policy is denied.
+// Metric 0 is number of calls and metric 1 is number of calls that blocked,
+// i.e. contended acquisitions, futex waits and condition variable waits.
+class LockPolicyListener : public PolicyListener
+{
+public:
+	LockPolicyListener();
+protected:
+	void OnPolicyViolation() override;
+	const char* MetricName(std::size_t metric) const noexcept override;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ThreadPolicyListener
+///////////////////////////////////////////////////////////////////////////////
+
+// Detects threads created (metric 0) while the thread_creation policy is 
+// denied and threads alive at the end of the test which were not alive when
+// the policy was applied (metric 1), i.e. threads not joined by the test.
+class ThreadPolicyListener : public PolicyListener
+{
+public:
+	ThreadPolicyListener();
+protected:
+	void OnPolicyViolation() override;
+	const char* MetricName(std::size_t metric) const noexcept override;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// OutputMonitoring
+///////////////////////////////////////////////////////////////////////////////
+
+// Mechanism used to detect writes to standard output or standard error.
+enum class OutputMonitoring
+{
+	// Filters the stream buffer of std::cout or std::cerr (default).
+	stream,
+
+	// Redirects file descriptor 1 or 2 through a pipe, which also detects
+	// printf, puts, fwrite, write(1, ...) etc. Only available on POSIX 
+	// platforms, otherwise falls back to stream monitoring.
+	file_descriptor
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -222,9 +879,11 @@ protected:
 class StdOutPolicyListener : public PolicyListener
 {
 public:
-	StdOutPolicyListener();
+	explicit StdOutPolicyListener(
+		OutputMonitoring monitoring = OutputMonitoring::stream);
 protected:
 	void OnPolicyViolation() override;
+	const char* MetricName(std::size_t metric) const noexcept override;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -234,9 +893,68 @@ protected:
 class StdErrPolicyListener : public PolicyListener
 {
 public:
-	StdErrPolicyListener();
+	explicit StdErrPolicyListener(
+		OutputMonitoring monitoring = OutputMonitoring::stream);
+protected:
+	void OnPolicyViolation() override;
+	const char* MetricName(std::size_t metric) const noexcept override;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ExecTimePolicyListener
+///////////////////////////////////////////////////////////////////////////////
+
+// Measures monotonic wall time and CPU time of the calling thread while the 
+// execution_time policy is denied. Metric 0 is wall time and metric 1 is CPU
+// time, both in nanoseconds.
+class ExecTimePolicyListener : public PolicyListener
+{
+public:
+	ExecTimePolicyListener();
+protected:
+	void OnPolicyViolation() override;
+	const char* MetricName(std::size_t metric) const noexcept override;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ResourceUsagePolicyListener
+///////////////////////////////////////////////////////////////////////////////
+
+// Measures page faults and context switches of the calling thread via 
+// getrusage while the resource_usage policy is denied. Metric 0 is minor 
+// page faults, metric 1 major page faults, metric 2 voluntary context 
+// switches and metric 3 involuntary context switches.
+class ResourceUsagePolicyListener : public PolicyListener
+{
+public:
+	ResourceUsagePolicyListener();
+protected:
+	void OnPolicyViolation() override;
+	const char* MetricName(std::size_t metric) const noexcept override;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// PerfCounterPolicyListener
+///////////////////////////////////////////////////////////////////////////////
+
+// Measures user space hardware performance counters of the thread first 
+// applying the hardware_counters policy via perf_event_open while denied.
+// Metric 0 is instructions, metric 1 cycles, metric 2 branch misses and 
+// metric 3 last level cache misses. Counter values are attached to the test 
+// result as properties. If counters are not available the policy is not 
+// enforced and a notice is printed instead.
+class PerfCounterPolicyListener : public PolicyListener
+{
+public:
+	PerfCounterPolicyListener();
+
+	// Returns true if at least one hardware counter could be opened.
+	static bool IsSupported() noexcept;
+
+	void OnTestEnd(const ::testing::TestInfo& test_info) override;
 protected:
 	void OnPolicyViolation() override;
+	const char* MetricName(std::size_t metric) const noexcept override;
 };
 
 } // namespace gtest_policies::listener
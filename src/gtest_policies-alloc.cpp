@@ -7,7 +7,20 @@
 
 #include <gtest_policies/gtest_policies.h>
 
+#include "gtest_policies-callstack.h"
+#include "gtest_policies-internal.h"
+
+#include <atomic>  // std::atomic
+#include <cerrno>  // EINVAL, ENOMEM
+#include <climits> // LONG_MAX
+#include <cstddef> // std::max_align_t
+#include <cstdlib> // malloc, free, __GLIBC__
+#include <fstream> // std::ofstream
+#include <new>     // std::bad_alloc, std::nothrow_t, std::align_val_t
+
 #ifdef _MSC_VER
+  #include <intrin.h> // _BitScanReverse
+
   #ifdef _DEBUG
     #ifndef GTEST_POLICY_CRTDBG_AVAILABLE
       #define GTEST_POLICY_CRTDBG_AVAILABLE
@@ -27,12 +40,22 @@
         "Detection only possible via globally overriding new/delete.")
     #endif // GTEST_POLICY_SILENCE_WARNINGS
   #endif // _DEBUG
+#elif defined(__GLIBC__) && !defined(GTEST_POLICY_DISABLE_MALLOC_HOOKS) && \
+      !defined(__SANITIZE_ADDRESS__)
+  // glibc allows the malloc family to be replaced by the executable while
+  // still exporting the original implementation as __libc_*, so allocations
+  // may be intercepted in any build configuration. Sanitizers replace the
+  // allocator themselves, hence define GTEST_POLICY_DISABLE_MALLOC_HOOKS to
+  // opt out (done automatically for GCC AddressSanitizer builds).
+  #ifndef GTEST_POLICY_MALLOC_HOOKS_AVAILABLE
+    #define GTEST_POLICY_MALLOC_HOOKS_AVAILABLE
+  #endif // GTEST_POLICY_MALLOC_HOOKS_AVAILABLE
 #else
   #ifndef GTEST_POLICY_SILENCE_WARNINGS
     #pragma message ( \
       "WARNING: gtest_policy::dynamic_memory_allocation policy." \
 	  "Memory allocation detection not supported on this compiler/platform." \
-      "Detection only possible via globally overriding new/delete.");
+      "Detection only possible via globally overriding new/delete.")
   #endif // GTEST_POLICY_SILENCE_WARNINGS
 #endif // _MSC_VER
 
@@ -54,18 +77,568 @@
   #include <Windows.h> // IsDebuggerPresent, DebugBreak
 #endif // GTEST_POLICY_CRTDBG_AVAILABLE
 
+#if defined(GTEST_POLICY_CRTDBG_AVAILABLE) || \
+    defined(GTEST_POLICY_MALLOC_HOOKS_AVAILABLE)
+  #define GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
+#endif
+
+#ifdef GTEST_POLICY_MALLOC_HOOKS_AVAILABLE
+  #include <malloc.h> // malloc_usable_size
+  #include <unistd.h> // sysconf
+#endif // GTEST_POLICY_MALLOC_HOOKS_AVAILABLE
+
+#ifdef GTEST_POLICY_MALLOC_HOOKS_AVAILABLE
+extern "C"
+{
+	// Original glibc allocator entry points. Forwarding to these rather than
+	// resolving the next symbol via dlsym avoids recursion since dlsym may
+	// itself allocate memory.
+	void* __libc_malloc(std::size_t size) noexcept;
+	void* __libc_calloc(std::size_t num, std::size_t size) noexcept;
+	void* __libc_realloc(void* ptr, std::size_t size) noexcept;
+	void* __libc_memalign(std::size_t alignment, std::size_t size) noexcept;
+	void* __libc_valloc(std::size_t size) noexcept;
+	void* __libc_pvalloc(std::size_t size) noexcept;
+	void  __libc_free(void* ptr) noexcept;
+}
+#endif // GTEST_POLICY_MALLOC_HOOKS_AVAILABLE
+
 namespace gtest_policies
 {
 #ifdef GTEST_POLICY_CRTDBG_AVAILABLE
 	_CRT_ALLOC_HOOK stored_alloc_hook = nullptr;
+
+	// Alignment of the aligned operator new currently allocating on this 
+	// thread, since the allocation hook is not told the alignment.
+	static thread_local std::size_t alloc_pending_alignment = 0u;
 #endif
 
-	class AllocMonitor : public gtest_policies::detail::PolicyMonitor
+#ifdef GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
+	struct AllocCounters
+	{
+		std::size_t count;
+		std::size_t bytes;
+	};
+
+	// Allocations are counted in cache line sized shards and each thread is
+	// assigned its own shard on its first allocation. This way threads do not
+	// contend on the same counters and the cost of summing all shards is 
+	// instead paid when monitoring starts and stops. Threads share shards 
+	// only if there are more threads than shards.
+	static const std::size_t alloc_shard_count = 128u;
+
+	struct alignas(64) AllocShard
+	{
+		std::atomic<std::size_t> count;
+		std::atomic<std::size_t> bytes;
+	};
+
+	static AllocShard alloc_shards[alloc_shard_count];
+	static std::atomic<std::size_t> alloc_next_shard(0u);
+
+	// The initial-exec TLS model guarantees that accessing the shard of the
+	// current thread never calls back into the allocator.
+	static thread_local AllocShard* alloc_shard 
+		GTEST_POLICY_TLS_INITIAL_EXEC = nullptr;
+
+	// Counters when monitoring was started
+	static AllocCounters alloc_baseline = { 0u, 0u };
+
+	static inline AllocShard& CurrentAllocShard() noexcept
+	{
+		auto shard = alloc_shard;
+		if (shard == nullptr)
+		{
+			const auto index = alloc_next_shard.fetch_add(
+				1u, std::memory_order_relaxed);
+			shard = &alloc_shards[index % alloc_shard_count];
+			alloc_shard = shard;
+		}
+		return *shard;
+	}
+
+	// Call sites and size classes of allocations are only recorded while 
+	// monitoring, i.e. while dynamic memory allocation is denied.
+	static detail::CallSiteTable alloc_call_sites;
+	static std::atomic<bool> alloc_monitoring(false);
+
+	// Size class histogram shared by all threads. Unlike the counters above
+	// it is only updated while monitoring, hence contention is not a concern.
+	struct AllocHistogramCounters
+	{
+		std::atomic<std::uint64_t> counts[listener::AllocationHistogram::size_classes];
+		std::atomic<std::uint64_t> bytes[listener::AllocationHistogram::size_classes];
+	};
+
+	static AllocHistogramCounters alloc_histogram;
+	static std::atomic<bool> alloc_histogram_used(false);
+
+	// Returns floor(log2(size)), i.e. the index of the highest bit set
+	static inline std::size_t SizeClass(std::size_t size) noexcept
+	{
+		const std::size_t last = listener::AllocationHistogram::size_classes - 1u;
+		if (size <= 1u)
+			return 0u;
+#if defined(_MSC_VER) && defined(_WIN64)
+		unsigned long size_class;
+		_BitScanReverse64(&size_class, size);
+#elif defined(_MSC_VER)
+		unsigned long size_class;
+		_BitScanReverse(&size_class, size);
+#else
+		const auto size_class = sizeof(unsigned long long) * CHAR_BIT - 1u - 
+			static_cast<std::size_t>(__builtin_clzll(size));
+#endif // defined(_MSC_VER)
+		return size_class < last ? size_class : last;
+	}
+
+	// Allocations requiring a greater alignment than guaranteed by malloc, 
+	// e.g. by aligned operator new for SIMD types, and the greatest alignment
+	// requested. Only updated while monitoring, like the histogram.
+	static const std::size_t default_alignment = alignof(std::max_align_t);
+	static std::atomic<std::size_t> alloc_aligned_count(0u);
+	static std::atomic<std::size_t> alloc_max_alignment(0u);
+
+	// Prevents recording allocations made by the unwinder itself
+	static thread_local bool alloc_recording 
+		GTEST_POLICY_TLS_INITIAL_EXEC = false;
+
+	static inline void CountAllocation(std::size_t size, 
+		std::size_t alignment, const void* caller) noexcept
+	{
+		// Counts are only evaluated relative to the baseline summed when 
+		// monitoring starts, hence allocations are not counted at all unless
+		// monitoring. This way a granted or unapplied policy costs a single
+		// relaxed load and branch per allocation. Allocations of threads out 
+		// of scope, or internal to this library, are not counted either.
+		if (!alloc_monitoring.load(std::memory_order_relaxed) || 
+			!detail::IsInThreadScope(dynamic_memory_allocation.Scope()) ||
+			detail::IsInternalScope())
+			return;
+
+		auto& shard = CurrentAllocShard();
+		shard.count.fetch_add(1u, std::memory_order_relaxed);
+		shard.bytes.fetch_add(size, std::memory_order_relaxed);
+
+		const auto size_class = SizeClass(size);
+		alloc_histogram.counts[size_class].fetch_add(
+			1u, std::memory_order_relaxed);
+		alloc_histogram.bytes[size_class].fetch_add(
+			size, std::memory_order_relaxed);
+
+		if (alignment > default_alignment)
+		{
+			alloc_aligned_count.fetch_add(1u, std::memory_order_relaxed);
+			auto current = alloc_max_alignment.load(std::memory_order_relaxed);
+			while (alignment > current && !alloc_max_alignment.compare_exchange_weak(
+				current, alignment, std::memory_order_relaxed))
+			{ }
+		}
+
+		if (!alloc_recording)
+		{
+			alloc_recording = true;
+			alloc_call_sites.Record(size, caller);
+			alloc_recording = false;
+		}
+	}
+
+	// Live blocks and bytes relative to when peak monitoring was started. 
+	// Only blocks allocated while monitoring are tracked, and only frees of
+	// tracked blocks are subtracted, since freeing a block allocated before,
+	// e.g. by a fixture, must not hide allocations made afterwards. Note 
+	// that these are shared by all threads since a peak is a property of 
+	// the whole heap.
+	struct LiveCounters
+	{
+		std::atomic<std::int64_t> blocks;
+		std::atomic<std::int64_t> bytes;
+	};
+
+	static std::atomic<bool> alloc_live_enabled(false);
+	static LiveCounters alloc_live;
+	static LiveCounters alloc_peak;
+
+	static inline void UpdatePeak(std::atomic<std::int64_t>& peak, 
+		std::int64_t live) noexcept
+	{
+		auto current = peak.load(std::memory_order_relaxed);
+		while (live > current && !peak.compare_exchange_weak(
+			current, live, std::memory_order_relaxed))
+		{ }
+	}
+
+	static inline void CountLive(std::int64_t blocks, 
+		std::int64_t bytes) noexcept
+	{
+		if (!alloc_live_enabled.load(std::memory_order_relaxed))
+			return;
+		UpdatePeak(alloc_peak.blocks, alloc_live.blocks.fetch_add(
+			blocks, std::memory_order_relaxed) + blocks);
+		UpdatePeak(alloc_peak.bytes, alloc_live.bytes.fetch_add(
+			bytes, std::memory_order_relaxed) + bytes);
+	}
+
+#ifdef GTEST_POLICY_CRTDBG_AVAILABLE
+	// Request number of the first block allocated while monitoring. The CRT
+	// debug heap numbers requests in increasing order, hence blocks with a 
+	// lower number were allocated before monitoring started.
+	static std::atomic<long> alloc_live_first_request(LONG_MAX);
+#endif // GTEST_POLICY_CRTDBG_AVAILABLE
+
+#ifdef GTEST_POLICY_MALLOC_HOOKS_AVAILABLE
+	// Preallocated lock-free open addressing hash table of heap blocks, keyed
+	// by address. Erased blocks leave tombstones which may be reused by later
+	// insertions. Blocks are not tracked if the table is full. A block is 
+	// always erased before being returned to the allocator, hence an address
+	// is never present more than once. An entry is reserved while its size 
+	// and call site are written and the key is published last, hence the 
+	// size and call site of a key are stable until the key is erased.
+	class LiveBlockTable
+	{
+	public:
+		static const std::size_t capacity = 16384u; // power of two
+		static const std::size_t max_probes = 256u;
+
+		LiveBlockTable() noexcept
+			: entries_(), used_(false), dropped_(0u)
+		{ }
+
+		void Insert(void* ptr, std::size_t size, std::size_t site) noexcept
+		{
+			const auto key = reinterpret_cast<std::uintptr_t>(ptr);
+			auto index = Hash(key);
+			used_.store(true, std::memory_order_relaxed);
+			for (std::size_t probe = 0; probe < max_probes; ++probe)
+			{
+				auto& entry = entries_[index];
+				auto current = entry.key.load(std::memory_order_relaxed);
+				if ((current == empty || current == tombstone) &&
+					entry.key.compare_exchange_strong(
+						current, reserved, std::memory_order_relaxed))
+				{
+					entry.size.store(size, std::memory_order_relaxed);
+					entry.site.store(site, std::memory_order_relaxed);
+					entry.key.store(key, std::memory_order_release);
+					return;
+				}
+				index = (index + 1u) & (capacity - 1u);
+			}
+			dropped_.fetch_add(1u, std::memory_order_relaxed);
+		}
+
+		// Erases ptr from the table if present and returns its size and 
+		// call site via size and site.
+		bool Erase(void* ptr, std::size_t& size, std::size_t& site) noexcept
+		{
+			if (!used_.load(std::memory_order_relaxed))
+				return false;
+
+			const auto key = reinterpret_cast<std::uintptr_t>(ptr);
+			auto index = Hash(key);
+			for (std::size_t probe = 0; probe < max_probes; ++probe)
+			{
+				auto& entry = entries_[index];
+				auto current = entry.key.load(std::memory_order_acquire);
+				if (current == empty)
+					return false;
+				if (current == key)
+				{
+					// Read before erasing since the entry may be reused by
+					// another thread as soon as it is a tombstone
+					size = entry.size.load(std::memory_order_relaxed);
+					site = entry.site.load(std::memory_order_relaxed);
+					return entry.key.compare_exchange_strong(
+						current, tombstone, std::memory_order_relaxed);
+				}
+				index = (index + 1u) & (capacity - 1u);
+			}
+			return false;
+		}
+
+		void Clear() noexcept
+		{
+			if (used_.load(std::memory_order_relaxed))
+			{
+				for (auto& entry : entries_)
+					entry.key.store(empty, std::memory_order_relaxed);
+			}
+			used_.store(false, std::memory_order_relaxed);
+			dropped_.store(0u, std::memory_order_relaxed);
+		}
+
+		// Invokes func(size, site) for each block in the table.
+		template<class Func>
+		void ForEach(Func func) const
+		{
+			if (!used_.load(std::memory_order_relaxed))
+				return;
+			for (const auto& entry : entries_)
+			{
+				const auto key = entry.key.load(std::memory_order_acquire);
+				if (key != empty && key != tombstone && key != reserved)
+				{
+					func(entry.size.load(std::memory_order_relaxed),
+						entry.site.load(std::memory_order_relaxed));
+				}
+			}
+		}
+
+		std::size_t Dropped() const noexcept
+		{
+			return dropped_.load(std::memory_order_relaxed);
+		}
+
+	private:
+		static const std::uintptr_t empty = 0u;
+		static const std::uintptr_t tombstone = 1u;
+		static const std::uintptr_t reserved = 2u;
+
+		static std::size_t Hash(std::uintptr_t key) noexcept
+		{
+			// Fibonacci hashing, low bits are zero due to alignment
+			const auto hash = static_cast<std::uint64_t>(key >> 4u) * 
+				11400714819323198485ull;
+			return static_cast<std::size_t>(hash >> 32u) & (capacity - 1u);
+		}
+
+		struct Entry
+		{
+			std::atomic<std::uintptr_t> key;
+			std::atomic<std::size_t> size;
+			std::atomic<std::size_t> site;
+		};
+
+		Entry entries_[capacity];
+		std::atomic<bool> used_;
+		std::atomic<std::size_t> dropped_;
+	};
+
+	// Blocks allocated while peak monitoring and their usable size, i.e. 
+	// including any rounding by the allocator. Blocks not tracked since the
+	// table is full are considered live until monitoring stops.
+	static LiveBlockTable peak_blocks;
+
+	static inline void CountLiveAllocation(void* ptr) noexcept
+	{
+		if (!alloc_live_enabled.load(std::memory_order_relaxed) ||
+			detail::IsInternalScope())
+			return;
+		const auto size = malloc_usable_size(ptr);
+		peak_blocks.Insert(ptr, size, detail::CallSiteTable::npos);
+		CountLive(1, static_cast<std::int64_t>(size));
+	}
+
+	static inline void CountLiveFree(void* ptr) noexcept
+	{
+		std::size_t size, site;
+		if (peak_blocks.Erase(ptr, size, site))
+			CountLive(-1, -static_cast<std::int64_t>(size));
+	}
+
+	// Blocks allocated while the memory leak policy is denied and their call
+	// sites. Blocks are erased when freed until the next test starts.
+	static LiveBlockTable leak_blocks;
+	static detail::CallSiteTable leak_call_sites;
+	static std::atomic<bool> leak_recording(false);
+
+	static inline void RecordLiveBlock(
+		void* ptr, std::size_t size, const void* caller) noexcept
+	{
+		if (!leak_recording.load(std::memory_order_relaxed) || alloc_recording ||
+			!detail::IsInThreadScope(memory_leaks.Scope()) ||
+			detail::IsInternalScope())
+			return;
+		alloc_recording = true;
+		leak_blocks.Insert(ptr, size, leak_call_sites.Record(size, caller));
+		alloc_recording = false;
+	}
+
+	static inline void OnAllocated(void* ptr, std::size_t size, 
+		std::size_t alignment, const void* caller) noexcept
+	{
+		CountAllocation(size, alignment, caller);
+		CountLiveAllocation(ptr);
+		RecordLiveBlock(ptr, size, caller);
+	}
+
+	static inline void OnFreeing(void* ptr) noexcept
+	{
+		CountLiveFree(ptr);
+		std::size_t size, site;
+		leak_blocks.Erase(ptr, size, site);
+	}
+#endif // GTEST_POLICY_MALLOC_HOOKS_AVAILABLE
+
+	static AllocCounters SumAllocShards() noexcept
+	{
+		AllocCounters sum = { 0u, 0u };
+		for (const auto& shard : alloc_shards)
+		{
+			sum.count += shard.count.load(std::memory_order_relaxed);
+			sum.bytes += shard.bytes.load(std::memory_order_relaxed);
+		}
+		return sum;
+	}
+#endif // GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
+
+	// Tracks the peak number of live blocks and bytes while denied. Since the
+	// listener sums usage of all denied periods within a test, only the 
+	// amount by which a period exceeds the peak of previous periods is 
+	// reported, which makes the accumulated usage the peak of the test.
+	class PeakHeapMonitor : public gtest_policies::detail::PolicyMonitor
 	{
 	public:
+		PeakHeapMonitor() 
+			: usage_(), peak_()
+		{ }
+
+		void Start() override
+		{
+#ifdef GTEST_POLICY_MALLOC_HOOKS_AVAILABLE
+			peak_blocks.Clear();
+#endif // GTEST_POLICY_MALLOC_HOOKS_AVAILABLE
 #ifdef GTEST_POLICY_CRTDBG_AVAILABLE
+			alloc_live_first_request.store(LONG_MAX, std::memory_order_relaxed);
+#endif // GTEST_POLICY_CRTDBG_AVAILABLE
+#ifdef GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
+			alloc_live.blocks.store(0, std::memory_order_relaxed);
+			alloc_live.bytes.store(0, std::memory_order_relaxed);
+			alloc_peak.blocks.store(0, std::memory_order_relaxed);
+			alloc_peak.bytes.store(0, std::memory_order_relaxed);
+			alloc_live_enabled.store(true, std::memory_order_seq_cst);
+#endif // GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
+		}
+
+		bool Stop() override
+		{
+#ifdef GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
+			alloc_live_enabled.store(false, std::memory_order_seq_cst);
+			const std::int64_t peak[] = { 
+				alloc_peak.blocks.load(std::memory_order_relaxed),
+				alloc_peak.bytes.load(std::memory_order_relaxed) };
+			bool active = false;
+			for (std::size_t i = 0; i < 2u; ++i)
+			{
+				const auto window = static_cast<std::uint64_t>(peak[i]);
+				usage_.metrics[i] = window > peak_.metrics[i] ? 
+					window - peak_.metrics[i] : 0u;
+				peak_.metrics[i] += usage_.metrics[i];
+				active = active || peak[i] > 0;
+			}
+			return active;
+#else
+			return false;
+#endif // GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
+		}
+
+		detail::PolicyUsage Usage() const override
+		{
+			return usage_;
+		}
+
+		void Reset() override
+		{
+#ifdef GTEST_POLICY_MALLOC_HOOKS_AVAILABLE
+			peak_blocks.Clear();
+#endif // GTEST_POLICY_MALLOC_HOOKS_AVAILABLE
+			peak_ = detail::PolicyUsage();
+		}
+
+	private:
+		detail::PolicyUsage usage_;
+		detail::PolicyUsage peak_;
+	};
+
+	// Records heap blocks allocated while denied and evaluates the blocks 
+	// still not freed when the test ends. With the CRT debug heap only the 
+	// difference in number of blocks and bytes is known.
+	class LeakMonitor : public gtest_policies::detail::PolicyMonitor
+	{
+	public:
+		LeakMonitor()
+			: usage_()
+#ifdef GTEST_POLICY_CRTDBG_AVAILABLE
+			, start_(), started_(false)
+#endif // GTEST_POLICY_CRTDBG_AVAILABLE
+		{ }
+
+		void Start() override
+		{
+#if defined(GTEST_POLICY_MALLOC_HOOKS_AVAILABLE)
+			detail::WarmUpCallStackCapture();
+			leak_recording.store(true, std::memory_order_seq_cst);
+#elif defined(GTEST_POLICY_CRTDBG_AVAILABLE)
+			if (!started_)
+			{
+				_CrtMemCheckpoint(&start_);
+				started_ = true;
+			}
+#endif
+		}
+
+		bool Stop() override
+		{
+#ifdef GTEST_POLICY_MALLOC_HOOKS_AVAILABLE
+			leak_recording.store(false, std::memory_order_seq_cst);
+#endif // GTEST_POLICY_MALLOC_HOOKS_AVAILABLE
+			return false; // evaluated when the test ends
+		}
+
+		bool Finish() override
+		{
+			usage_ = detail::PolicyUsage();
+#if defined(GTEST_POLICY_MALLOC_HOOKS_AVAILABLE)
+			leak_blocks.ForEach([this](std::size_t size, std::size_t) {
+				++usage_.metrics[0];
+				usage_.metrics[1] += size;
+			});
+#elif defined(GTEST_POLICY_CRTDBG_AVAILABLE)
+			if (!started_)
+				return false;
+			started_ = false;
+			_CrtMemState end, diff;
+			_CrtMemCheckpoint(&end);
+			if (!_CrtMemDifference(&diff, &start_, &end))
+				return false;
+			if (diff.lCounts[_NORMAL_BLOCK] > 0)
+				usage_.metrics[0] = diff.lCounts[_NORMAL_BLOCK];
+			if (diff.lSizes[_NORMAL_BLOCK] > 0)
+				usage_.metrics[1] = diff.lSizes[_NORMAL_BLOCK];
+#endif
+			return usage_.metrics[0] != 0u || usage_.metrics[1] != 0u;
+		}
+
+		detail::PolicyUsage Usage() const override
+		{
+			return usage_;
+		}
+
+		void Reset() override
+		{
+#if defined(GTEST_POLICY_MALLOC_HOOKS_AVAILABLE)
+			leak_blocks.Clear();
+			leak_call_sites.Clear();
+#elif defined(GTEST_POLICY_CRTDBG_AVAILABLE)
+			started_ = false;
+#endif
+			usage_ = detail::PolicyUsage();
+		}
+
+	private:
+		detail::PolicyUsage usage_;
+#ifdef GTEST_POLICY_CRTDBG_AVAILABLE
+		_CrtMemState start_;
+		bool started_;
+#endif // GTEST_POLICY_CRTDBG_AVAILABLE
+	};
+
+	class AllocMonitor : public gtest_policies::detail::PolicyMonitor
+	{
+	public:
+#ifdef GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
 		AllocMonitor()
-			: pre_count_(0u)
+			: post_()
 		{ 
 		}
 #else
@@ -74,38 +647,59 @@ namespace gtest_policies
 
 		~AllocMonitor() = default;
 
-		void Start() 
+		void Start() override
 		{
 #ifdef GTEST_POLICY_CRTDBG_AVAILABLE
-			if (IsDebuggerPresent())
-			{
-				stored_alloc_hook = _CrtSetAllocHook(AllocHook);
-			}
-
-			_CrtMemState state;
-			_CrtMemCheckpoint(&state);
-			pre_count_ = state.lTotalCount;
+			stored_alloc_hook = _CrtSetAllocHook(AllocHook);
 #endif // GTEST_POLICY_CRTDBG_AVAILABLE
+#ifdef GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
+			detail::WarmUpCallStackCapture();
+			alloc_baseline = SumAllocShards();
+			alloc_histogram_used.store(true, std::memory_order_relaxed);
+			alloc_monitoring.store(true, std::memory_order_relaxed);
+#endif // GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
 		}
 
-		bool Stop() 
+		bool Stop() override
 		{
+#ifdef GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
+			alloc_monitoring.store(false, std::memory_order_relaxed);
+			post_ = SumAllocShards();
 #ifdef GTEST_POLICY_CRTDBG_AVAILABLE
-			_CrtMemState state;
-			_CrtMemCheckpoint(&state);
-			const auto post_count = state.lTotalCount;
+			_CrtSetAllocHook(stored_alloc_hook);
+			stored_alloc_hook = nullptr;
+#endif // GTEST_POLICY_CRTDBG_AVAILABLE
+			return post_.count != alloc_baseline.count; // allocated or not
+#else
+            return false;
+#endif // GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
+		}
+
+		detail::PolicyUsage Usage() const override
+		{
+			detail::PolicyUsage usage = { { 0u, 0u } };
+#ifdef GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
+			usage.metrics[0] = post_.count - alloc_baseline.count;
+			usage.metrics[1] = post_.bytes - alloc_baseline.bytes;
+#endif // GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
+			return usage;
+		}
 
-			if (IsDebuggerPresent())
+		void Reset() override
+		{
+#ifdef GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
+			alloc_call_sites.Clear();
+			alloc_aligned_count.store(0u, std::memory_order_relaxed);
+			alloc_max_alignment.store(0u, std::memory_order_relaxed);
+			if (alloc_histogram_used.exchange(false, std::memory_order_relaxed))
 			{
-				_CrtSetAllocHook(stored_alloc_hook);
-				stored_alloc_hook = nullptr;
+				for (std::size_t i = 0; i < listener::AllocationHistogram::size_classes; ++i)
+				{
+					alloc_histogram.counts[i].store(0u, std::memory_order_relaxed);
+					alloc_histogram.bytes[i].store(0u, std::memory_order_relaxed);
+				}
 			}
-
-			const auto diff = post_count - pre_count_;
-			return diff != 0; // memory was allocated or not
-#else
-            return false;
-#endif // GTEST_POLICY_CRTDBG_AVAILABLE
+#endif // GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
 		}
 
 	private:
@@ -134,81 +728,690 @@ namespace gtest_policies
 			const unsigned char * szFileName,
 			int nLine)
 		{
+			if (nAllocType != _HOOK_ALLOC && pvData != nullptr &&
+				alloc_live_enabled.load(std::memory_order_relaxed))
+			{
+				// Block being freed or reallocated, only subtracted if 
+				// allocated while monitoring
+				const auto size = _msize_dbg(pvData, nBlockUse);
+				long request = 0;
+				if (_CrtIsMemoryBlock(pvData, static_cast<unsigned>(size), 
+						&request, nullptr, nullptr) &&
+					request >= alloc_live_first_request.load(
+						std::memory_order_relaxed))
+				{
+					CountLive(-1, -static_cast<std::int64_t>(size));
+				}
+			}
+
 			if (nAllocType == _HOOK_FREE)
 				return InvokeWrappedAllocHook(nAllocType, pvData, nSize, nBlockUse, lRequest, szFileName, nLine);
 
+			const auto alignment = alloc_pending_alignment;
+			alloc_pending_alignment = 0u;
+			CountAllocation(nSize, alignment, nullptr);
+			if (alloc_live_enabled.load(std::memory_order_relaxed))
+			{
+				auto first = alloc_live_first_request.load(
+					std::memory_order_relaxed);
+				while (lRequest < first && 
+					!alloc_live_first_request.compare_exchange_weak(
+						first, lRequest, std::memory_order_relaxed))
+				{ }
+				CountLive(1, static_cast<std::int64_t>(nSize));
+			}
+
 			// IMPORTANT INFORMATION:
 			// If your debugger breaks here it means allocation has been denied 
-			// explicitly by the gtest_policies::dynamic_memory_allocation policy. 
-			// Check your current call stack to find out where this memory allocation 
-			// originates from.
+			// explicitly by the gtest_policies::dynamic_memory_allocation policy,
+			// or its budget has been exceeded. Check your current call stack to 
+			// find out where this memory allocation originates from.
 			if (gtest_policies::dynamic_memory_allocation.IsDenied() &&
-				gtest_policies::dynamic_memory_allocation.IsViolated() &&
 				IsDebuggerPresent())
 			{
-				DebugBreak();
+				const auto current = SumAllocShards();
+				if (current.count - alloc_baseline.count > 
+						dynamic_memory_allocation.Limit(0) ||
+					current.bytes - alloc_baseline.bytes > 
+						dynamic_memory_allocation.Limit(1))
+				{
+					DebugBreak();
+				}
 			}
 
 			return InvokeWrappedAllocHook(nAllocType, pvData, nSize, nBlockUse, lRequest, szFileName, nLine);
 		}
+#endif // GTEST_POLICY_CRTDBG_AVAILABLE
 
-		size_t pre_count_;
-#endif
+#ifdef GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
+		AllocCounters post_;
+#endif // GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
 	};
 }
 
 #ifdef GTEST_POLICY_CRTDBG_AVAILABLE
 
-// Override global new/delete and use malloc/free as underlying functions.
-// Makes it possible to intercept all allocation being done with regular 
-// new/delete operators.
+// Override every replaceable global new/delete and use malloc/free, or 
+// _aligned_malloc/_aligned_free for over-aligned types, as underlying 
+// functions. Makes it possible to intercept all allocation being done with 
+// new/delete operators. Allocations are accounted by the allocation hook.
 
-#ifdef _MSC_VER
-// MSVC C++11/14/17 do not support throw(exception) 
-void* operator new(std::size_t s) throw()
-#else
-void* operator new(std::size_t s) throw(std::bad_alloc)
-#endif
+namespace gtest_policies
 {
-    gtest_policies::dynamic_memory_allocation.MarkAsViolated();
-	return malloc(s);
+	// Allocates as the replaceable operator new, i.e. invokes the new handler
+	// until allocation succeeds and throws std::bad_alloc if there is none.
+	// An alignment of zero denotes the default alignment.
+	static void* NewBlock(std::size_t size, std::size_t alignment)
+	{
+		if (size == 0u)
+			size = 1u; // distinct non-null pointer required
+		for (;;)
+		{
+			alloc_pending_alignment = alignment;
+			void* ptr = alignment == 0u ? 
+				malloc(size) : _aligned_malloc(size, alignment);
+			alloc_pending_alignment = 0u;
+			if (ptr != nullptr)
+				return ptr;
+
+			const auto handler = std::get_new_handler();
+			if (handler == nullptr)
+				throw std::bad_alloc();
+			handler();
+		}
+	}
+
+	static void* NewBlockNoThrow(std::size_t size, 
+		std::size_t alignment) noexcept
+	{
+		try
+		{
+			return NewBlock(size, alignment);
+		}
+		catch (...)
+		{
+			return nullptr;
+		}
+	}
 }
 
-void  operator delete(void* p) throw()
+void* operator new(std::size_t size)
 {
-	free(p);
+	return gtest_policies::NewBlock(size, 0u);
 }
 
-#ifdef _MSC_VER
-// MSVC C++11/14/17 do not support throw(exception) 
-void *operator new[](std::size_t s) throw()
-#else
-void *operator new[](std::size_t s) throw(std::bad_alloc)
-#endif
+void* operator new[](std::size_t size)
+{
+	return gtest_policies::NewBlock(size, 0u);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
 {
-    gtest_policies::dynamic_memory_allocation.MarkAsViolated();
-	return malloc(s);
+	return gtest_policies::NewBlockNoThrow(size, 0u);
 }
 
-void operator delete[](void *p) throw()
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
 {
-	free(p);
+	return gtest_policies::NewBlockNoThrow(size, 0u);
 }
 
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+	free(ptr);
+}
+
+#ifdef __cpp_aligned_new
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	return gtest_policies::NewBlock(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return gtest_policies::NewBlock(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, 
+	const std::nothrow_t&) noexcept
+{
+	return gtest_policies::NewBlockNoThrow(
+		size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, 
+	const std::nothrow_t&) noexcept
+{
+	return gtest_policies::NewBlockNoThrow(
+		size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+	_aligned_free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+	_aligned_free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t, 
+	const std::nothrow_t&) noexcept
+{
+	_aligned_free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t, 
+	const std::nothrow_t&) noexcept
+{
+	_aligned_free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+	_aligned_free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept
+{
+	_aligned_free(ptr);
+}
+#endif // __cpp_aligned_new
+
 #endif // GTEST_POLICY_CRTDBG_AVAILABLE
 
-gtest_policies::listener::MemAllocPolicyListener::MemAllocPolicyListener() :
-	PolicyListener(dynamic_memory_allocation, std::make_unique<AllocMonitor>())
+#ifdef GTEST_POLICY_MALLOC_HOOKS_AVAILABLE
+
+// Replace the C allocation functions of the process. The C++ runtime 
+// implements all replaceable new and delete operators on top of these, 
+// including the nothrow, sized and aligned variants, so this also 
+// intercepts new/delete of a program replacing new itself. Aligned 
+// allocations are accounted with their alignment.
+
+extern "C" void* malloc(std::size_t size) noexcept
+{
+	void* ptr = __libc_malloc(size);
+	if (ptr != nullptr)
+		gtest_policies::OnAllocated(ptr, size, 0u, __builtin_return_address(0));
+	return ptr;
+}
+
+extern "C" void* calloc(std::size_t num, std::size_t size) noexcept
+{
+	void* ptr = __libc_calloc(num, size);
+	if (ptr != nullptr)
+	{
+		gtest_policies::OnAllocated(
+			ptr, num * size, 0u, __builtin_return_address(0));
+	}
+	return ptr;
+}
+
+extern "C" void* realloc(void* ptr, std::size_t size) noexcept
+{
+	// The original block must be accounted before it is released since it
+	// may be handed out to another thread as soon as it has been released.
+	std::size_t live_size = 0u, live_site = 0u;
+	const bool live = ptr != nullptr &&
+		gtest_policies::peak_blocks.Erase(ptr, live_size, live_site);
+	std::size_t tracked_size = 0u, tracked_site = 0u;
+	const bool tracked = ptr != nullptr && 
+		gtest_policies::leak_blocks.Erase(ptr, tracked_size, tracked_site);
+
+	void* new_ptr = __libc_realloc(ptr, size);
+	if (new_ptr != nullptr || size == 0u)
+	{
+		// Original block freed
+		if (live)
+			gtest_policies::CountLive(-1, -static_cast<std::int64_t>(live_size));
+		if (new_ptr != nullptr)
+		{
+			gtest_policies::OnAllocated(
+				new_ptr, size, 0u, __builtin_return_address(0));
+		}
+	}
+	else
+	{
+		// Reallocation failed, original block is still allocated
+		if (live)
+			gtest_policies::peak_blocks.Insert(ptr, live_size, live_site);
+		if (tracked)
+			gtest_policies::leak_blocks.Insert(ptr, tracked_size, tracked_site);
+	}
+	return new_ptr;
+}
+
+extern "C" int posix_memalign(
+	void** memptr, std::size_t alignment, std::size_t size) noexcept
+{
+	// Alignment must be a power of two multiple of sizeof(void*)
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0 ||
+		alignment % sizeof(void*) != 0)
+		return EINVAL;
+
+	void* ptr = __libc_memalign(alignment, size);
+	if (ptr == nullptr)
+		return ENOMEM;
+
+	gtest_policies::OnAllocated(
+		ptr, size, alignment, __builtin_return_address(0));
+	*memptr = ptr;
+	return 0;
+}
+
+extern "C" void* aligned_alloc(std::size_t alignment, std::size_t size) noexcept
+{
+	// Alignment must be a power of two. Rejected here as by recent glibc, 
+	// since memalign would round it up and allocate.
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+	{
+		errno = EINVAL;
+		return nullptr;
+	}
+
+	void* ptr = __libc_memalign(alignment, size);
+	if (ptr != nullptr)
+	{
+		gtest_policies::OnAllocated(
+			ptr, size, alignment, __builtin_return_address(0));
+	}
+	return ptr;
+}
+
+extern "C" void* memalign(std::size_t alignment, std::size_t size) noexcept
+{
+	void* ptr = __libc_memalign(alignment, size);
+	if (ptr != nullptr)
+	{
+		gtest_policies::OnAllocated(
+			ptr, size, alignment, __builtin_return_address(0));
+	}
+	return ptr;
+}
+
+extern "C" void* valloc(std::size_t size) noexcept
+{
+	void* ptr = __libc_valloc(size);
+	if (ptr != nullptr)
+	{
+		gtest_policies::OnAllocated(ptr, size, 
+			static_cast<std::size_t>(sysconf(_SC_PAGESIZE)), 
+			__builtin_return_address(0));
+	}
+	return ptr;
+}
+
+extern "C" void* pvalloc(std::size_t size) noexcept
+{
+	void* ptr = __libc_pvalloc(size);
+	if (ptr != nullptr)
+	{
+		gtest_policies::OnAllocated(ptr, size, 
+			static_cast<std::size_t>(sysconf(_SC_PAGESIZE)), 
+			__builtin_return_address(0));
+	}
+	return ptr;
+}
+
+extern "C" void free(void* ptr) noexcept
+{
+	if (ptr != nullptr)
+		gtest_policies::OnFreeing(ptr);
+	__libc_free(ptr);
+}
+
+// Call sites are keyed by the return address of the allocation function, 
+// which for new would be within the C++ runtime for all allocations. Hence 
+// the new operators are also replaced, weakly so that a program replacing 
+// them itself takes precedence. The delete operators of the C++ runtime 
+// free via free, hence they need not be replaced.
+
+namespace gtest_policies
+{
+	// Allocates as the replaceable operator new, i.e. invokes the new handler
+	// until allocation succeeds and throws std::bad_alloc if there is none.
+	// An alignment of zero denotes the default alignment.
+	static void* NewBlock(std::size_t size, std::size_t alignment, 
+		const void* caller)
+	{
+		if (size == 0u)
+			size = 1u; // distinct non-null pointer required
+		for (;;)
+		{
+			void* ptr = alignment == 0u ? 
+				__libc_malloc(size) : __libc_memalign(alignment, size);
+			if (ptr != nullptr)
+			{
+				OnAllocated(ptr, size, alignment, caller);
+				return ptr;
+			}
+
+			const auto handler = std::get_new_handler();
+			if (handler == nullptr)
+				throw std::bad_alloc();
+			handler();
+		}
+	}
+
+	static void* NewBlockNoThrow(std::size_t size, std::size_t alignment,
+		const void* caller) noexcept
+	{
+		try
+		{
+			return NewBlock(size, alignment, caller);
+		}
+		catch (...)
+		{
+			return nullptr;
+		}
+	}
+}
+
+__attribute__((weak)) void* operator new(std::size_t size)
+{
+	return gtest_policies::NewBlock(size, 0u, __builtin_return_address(0));
+}
+
+__attribute__((weak)) void* operator new[](std::size_t size)
+{
+	return gtest_policies::NewBlock(size, 0u, __builtin_return_address(0));
+}
+
+__attribute__((weak)) void* operator new(std::size_t size, 
+	const std::nothrow_t&) noexcept
+{
+	return gtest_policies::NewBlockNoThrow(
+		size, 0u, __builtin_return_address(0));
+}
+
+__attribute__((weak)) void* operator new[](std::size_t size, 
+	const std::nothrow_t&) noexcept
+{
+	return gtest_policies::NewBlockNoThrow(
+		size, 0u, __builtin_return_address(0));
+}
+
+#ifdef __cpp_aligned_new
+__attribute__((weak)) void* operator new(std::size_t size, 
+	std::align_val_t alignment)
+{
+	return gtest_policies::NewBlock(size, 
+		static_cast<std::size_t>(alignment), __builtin_return_address(0));
+}
+
+__attribute__((weak)) void* operator new[](std::size_t size, 
+	std::align_val_t alignment)
+{
+	return gtest_policies::NewBlock(size, 
+		static_cast<std::size_t>(alignment), __builtin_return_address(0));
+}
+
+__attribute__((weak)) void* operator new(std::size_t size, 
+	std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return gtest_policies::NewBlockNoThrow(size, 
+		static_cast<std::size_t>(alignment), __builtin_return_address(0));
+}
+
+__attribute__((weak)) void* operator new[](std::size_t size, 
+	std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return gtest_policies::NewBlockNoThrow(size, 
+		static_cast<std::size_t>(alignment), __builtin_return_address(0));
+}
+#endif // __cpp_aligned_new
+
+#endif // GTEST_POLICY_MALLOC_HOOKS_AVAILABLE
+
+gtest_policies::listener::MemPeakPolicyListener::MemPeakPolicyListener() :
+	PolicyListener(peak_heap_usage, std::make_unique<PeakHeapMonitor>())
+{ }
+
+const char* gtest_policies::listener::MemPeakPolicyListener::MetricName(
+	std::size_t metric) const noexcept
+{
+	static const char* const names[] = { "peak_live_allocations", 
+		"peak_live_bytes" };
+	return metric < sizeof(names) / sizeof(names[0]) ? names[metric] : nullptr;
+}
+
+void gtest_policies::listener::MemPeakPolicyListener::OnPolicyViolation()
+{
+	const auto& usage = Usage();
+	const auto& budget = Policy().Budget();
+	auto& ss = ViolationReport();
+	ss << "Policy violation: gtest_policy::peak_heap_usage\n"
+		"Peak live heap memory exceeded the budget permitted by the test "
+		"policy for this test case. "
+		"Peak live allocations: " << usage.metrics[0]
+		<< " (budget: " << detail::FormatLimit(budget.metrics[0]) << "), "
+		<< "peak live bytes: " << usage.metrics[1]
+		<< " (budget: " << detail::FormatLimit(budget.metrics[1]) << "). ";
+	GTEST_NONFATAL_FAILURE_(ss.c_str());
+}
+
+gtest_policies::listener::MemLeakPolicyListener::MemLeakPolicyListener() :
+	PolicyListener(memory_leaks, std::make_unique<LeakMonitor>())
+{ }
+
+const char* gtest_policies::listener::MemLeakPolicyListener::MetricName(
+	std::size_t metric) const noexcept
+{
+	static const char* const names[] = { "leaked_allocations", "leaked_bytes" };
+	return metric < sizeof(names) / sizeof(names[0]) ? names[metric] : nullptr;
+}
+
+void gtest_policies::listener::MemLeakPolicyListener::OnPolicyViolation()
+{
+	const auto& usage = Usage();
+	const auto& budget = Policy().Budget();
+	auto& ss = ViolationReport();
+	ss << "Policy violation: gtest_policy::memory_leaks\n"
+		"Memory allocated during this test case has not been freed at the "
+		"end of the test case. "
+		"Leaked allocations: " << usage.metrics[0]
+		<< " (budget: " << detail::FormatLimit(budget.metrics[0]) << "), "
+		<< "leaked bytes: " << usage.metrics[1]
+		<< " (budget: " << detail::FormatLimit(budget.metrics[1]) << "). ";
+
+#ifdef GTEST_POLICY_MALLOC_HOOKS_AVAILABLE
+	// Aggregate leaked blocks per call site and report the call sites 
+	// having leaked the most bytes. Preallocated since reporting must not
+	// allocate memory.
+	const std::size_t npos = detail::CallSiteTable::npos;
+	static detail::CallSite sites[detail::CallSiteTable::capacity];
+	static std::size_t indices[detail::CallSiteTable::capacity];
+	std::size_t n = 0u;
+	for (auto& index : indices)
+		index = npos;
+	leak_blocks.ForEach([&](std::size_t size, std::size_t site) {
+		if (site == npos)
+			return; // call stack not captured
+		if (indices[site] == npos)
+		{
+			indices[site] = n;
+			sites[n] = leak_call_sites.Site(site);
+			sites[n].count = 0u;
+			sites[n].bytes = 0u;
+			++n;
+		}
+		++sites[indices[site]].count;
+		sites[indices[site]].bytes += size;
+	});
+
+	// Select top sites by bytes, ties in order of first occurrence
+	const std::size_t max_sites = 5u;
+	detail::CallSite top[max_sites];
+	std::size_t top_n = 0u;
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		std::size_t j = top_n < max_sites ? top_n++ : max_sites;
+		for (; j > 0u && top[j - 1u].bytes < sites[i].bytes; --j)
+		{
+			if (j < max_sites)
+				top[j] = top[j - 1u];
+		}
+		if (j < max_sites)
+			top[j] = sites[i];
+	}
+	detail::DescribeCallSites(ss, top, top_n, n, leak_blocks.Dropped(), 
+		"leaked allocation");
+#endif // GTEST_POLICY_MALLOC_HOOKS_AVAILABLE
+	GTEST_NONFATAL_FAILURE_(ss.c_str());
+}
+
+gtest_policies::listener::MemAllocPolicyListener::MemAllocPolicyListener(
+	const char* histogram_file) :
+	PolicyListener(dynamic_memory_allocation, std::make_unique<AllocMonitor>()),
+	histogram_(),
+	histogram_file_(histogram_file != nullptr ? std::string(histogram_file) :
+		detail::GetEnv("GTEST_POLICIES_ALLOCATION_HISTOGRAM")),
+	histogram_json_()
 { }
 
+const char* gtest_policies::listener::MemAllocPolicyListener::MetricName(
+	std::size_t metric) const noexcept
+{
+	static const char* const names[] = { "allocations", "allocated_bytes" };
+	return metric < sizeof(names) / sizeof(names[0]) ? names[metric] : nullptr;
+}
+
+void gtest_policies::listener::MemAllocPolicyListener::OnTestEnd(
+	const ::testing::TestInfo& test_info)
+{
+	PolicyListener::OnTestEnd(test_info);
+
+	detail::InternalScope scope;
+	histogram_ = AllocationHistogram();
+	bool empty = true;
+#ifdef GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
+	for (std::size_t i = 0; i < AllocationHistogram::size_classes; ++i)
+	{
+		histogram_.counts[i] = alloc_histogram.counts[i].load(
+			std::memory_order_relaxed);
+		histogram_.bytes[i] = alloc_histogram.bytes[i].load(
+			std::memory_order_relaxed);
+		empty = empty && histogram_.counts[i] == 0u;
+	}
+#endif // GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
+	if (empty)
+		return;
+
+	// Non-empty size classes as a JSON array
+	std::string json = "[";
+	for (std::size_t i = 0; i < AllocationHistogram::size_classes; ++i)
+	{
+		if (histogram_.counts[i] == 0u)
+			continue;
+		if (json.size() > 1u)
+			json += ',';
+		const std::uint64_t min_size = i == 0u ? 0u : std::uint64_t(1u) << i;
+		json += "{\"min_size\":" + std::to_string(min_size);
+		if (i + 1u < AllocationHistogram::size_classes)
+			json += ",\"max_size\":" + std::to_string((std::uint64_t(2u) << i) - 1u);
+		json += ",\"count\":" + std::to_string(histogram_.counts[i]) + 
+			",\"bytes\":" + std::to_string(histogram_.bytes[i]) + "}";
+	}
+	json += ']';
+	::testing::Test::RecordProperty("allocation_histogram", json);
+
+	if (histogram_file_.empty())
+		return;
+	histogram_json_ += histogram_json_.empty() ? "\n    " : ",\n    ";
+	histogram_json_ += "{\"suite\":";
+	detail::AppendJsonString(histogram_json_, test_info.test_suite_name());
+	histogram_json_ += ",\"test\":";
+	detail::AppendJsonString(histogram_json_, test_info.name());
+	histogram_json_ += ",\"histogram\":" + json + "}";
+}
+
+void gtest_policies::listener::MemAllocPolicyListener::OnTestProgramEnd(
+	const ::testing::UnitTest& unit_test)
+{
+	PolicyListener::OnTestProgramEnd(unit_test);
+	if (histogram_file_.empty())
+		return;
+
+	std::ofstream file(histogram_file_);
+	file << "{\n  \"tests\": [" << histogram_json_ << "\n  ]\n}\n";
+	if (!file)
+	{
+		std::fprintf(stderr, "WARNING: gtest_policies failed to write "
+			"allocation histogram to \"%s\".\n", histogram_file_.c_str());
+	}
+}
+
+const gtest_policies::listener::AllocationHistogram& 
+gtest_policies::listener::MemAllocPolicyListener::Histogram() const noexcept
+{
+	return histogram_;
+}
+
 void gtest_policies::listener::MemAllocPolicyListener::OnPolicyViolation()
 {
-	GTEST_NONFATAL_FAILURE_(\
-		"Policy violation: gtest_policy::dynamic_memory_allocation\n" \
-		"Dynamic memory allocation is not permitted by the test policy " \
-		"for this test case. " \
-		"Re-run the test case in debug mode with debugger attached to " \
-		"break at the allocation causing this policy violation. ");
+	const auto& usage = Usage();
+	const auto& budget = Policy().Budget();
+	auto& ss = ViolationReport();
+	ss << "Policy violation: gtest_policy::dynamic_memory_allocation\n";
+	if (budget.metrics[0] == 0u)
+	{
+		ss << "Dynamic memory allocation is not permitted by the test policy "
+			"for this test case. ";
+	}
+	else
+	{
+		ss << "Dynamic memory allocation exceeded the budget permitted by the "
+			"test policy for this test case. ";
+	}
+	ss << "Allocations: " << usage.metrics[0] 
+		<< " (budget: " << detail::FormatLimit(budget.metrics[0]) << "), "
+		<< "bytes: " << usage.metrics[1]
+		<< " (budget: " << detail::FormatLimit(budget.metrics[1]) << "). ";
+
+#ifdef GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
+	const auto aligned = alloc_aligned_count.load(std::memory_order_relaxed);
+	if (aligned != 0u)
+	{
+		ss << "Over-aligned allocations: " << aligned << " (max alignment: "
+			<< alloc_max_alignment.load(std::memory_order_relaxed) << "). ";
+	}
+
+	const bool has_call_sites = detail::DescribeCallSites(
+		ss, alloc_call_sites, "allocation", 5u);
+#else
+	const bool has_call_sites = false;
+#endif // GTEST_POLICY_ALLOC_COUNTERS_AVAILABLE
+	if (!has_call_sites)
+	{
+		ss << "Re-run the test case in debug mode with debugger attached to "
+			"break at the allocation causing this policy violation. ";
+	}
+	GTEST_NONFATAL_FAILURE_(ss.c_str());
 }
 
 #endif // GTEST_POLICY_ALLOC_H
\ No newline at end of file
@@ -0,0 +1,352 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+#include "gtest_policies-callstack.h"
+
+#include <gtest_policies/gtest_policies.h>
+
+#include "gtest_policies-internal.h"
+
+#include <cstdlib>       // std::free, __GLIBC__
+#include <mutex>         // std::mutex, std::lock_guard
+#include <sstream>       // std::stringstream
+#include <unordered_map> // std::unordered_map
+
+#if defined(__GLIBC__)
+  #define GTEST_POLICY_EXECINFO_AVAILABLE
+  #include <cxxabi.h>   // abi::__cxa_demangle
+  #include <dlfcn.h>    // dladdr
+  #include <execinfo.h> // backtrace
+#elif defined(_MSC_VER)
+  #define GTEST_POLICY_DBGHELP_AVAILABLE
+  #ifndef NOMINMAX
+    #define NOMINMAX 1
+  #endif // NOMINMAX
+  #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+  #endif // WIN32_LEAN_AND_MEAN
+  #include <Windows.h> // RtlCaptureStackBackTrace
+  #include <DbgHelp.h> // SymFromAddr
+  #pragma comment(lib, "dbghelp.lib")
+#endif
+
+namespace
+{
+	// Additional frames captured to allow omitting interception functions
+	const std::size_t skip_margin = 8u;
+
+#if defined(GTEST_POLICY_EXECINFO_AVAILABLE) || \
+    defined(GTEST_POLICY_DBGHELP_AVAILABLE)
+	const bool call_stacks_supported = true;
+#else
+	const bool call_stacks_supported = false;
+#endif
+
+	std::uint64_t HashFrames(void* const* frames, std::size_t depth) noexcept
+	{
+		// FNV-1a, zero is reserved for empty table entries
+		std::uint64_t hash = 14695981039346656037ull;
+		for (std::size_t i = 0; i < depth; ++i)
+		{
+			hash ^= reinterpret_cast<std::uintptr_t>(frames[i]);
+			hash *= 1099511628211ull;
+		}
+		return hash != 0u ? hash : 1u;
+	}
+}
+
+std::size_t gtest_policies::detail::CaptureCallStack(
+	void** frames, std::size_t max_frames, const void* caller) noexcept
+{
+	void* buffer[CallSiteTable::max_depth + skip_margin];
+	const std::size_t buffer_size = sizeof(buffer) / sizeof(buffer[0]);
+	const std::size_t capacity =
+		max_frames + skip_margin < buffer_size ?
+		max_frames + skip_margin : buffer_size;
+
+#if defined(GTEST_POLICY_EXECINFO_AVAILABLE)
+	const auto captured = static_cast<std::size_t>(
+		backtrace(buffer, static_cast<int>(capacity)));
+#elif defined(GTEST_POLICY_DBGHELP_AVAILABLE)
+	const auto captured = static_cast<std::size_t>(
+		RtlCaptureStackBackTrace(0, static_cast<DWORD>(capacity), buffer, nullptr));
+#else
+	(void)capacity;
+	(void)caller;
+	const std::size_t captured = 0u;
+#endif
+
+	std::size_t first = 0u;
+	for (std::size_t i = 0; i < captured; ++i)
+	{
+		if (buffer[i] == caller)
+		{
+			first = i;
+			break;
+		}
+	}
+
+	std::size_t depth = 0u;
+	for (std::size_t i = first; i < captured && depth < max_frames; ++i)
+		frames[depth++] = buffer[i];
+	return depth;
+}
+
+void gtest_policies::detail::WarmUpCallStackCapture() noexcept
+{
+	// First call of backtrace loads the unwinder which allocates memory. 
+	// Monitors may be started by any thread, hence initialized once as a 
+	// function local static.
+	static const bool warmed_up = []() noexcept {
+		void* frames[1];
+		CaptureCallStack(frames, 1u, nullptr);
+		return true;
+	}();
+	(void)warmed_up;
+}
+
+const std::string& gtest_policies::detail::Symbolize(void* address)
+{
+	// Reports may be made from any thread. Entries are never erased, hence
+	// returned references stay valid after the lock is released. Locking is
+	// internal to this library and not accounted by lock_acquisition.
+	static std::mutex mutex;
+	static std::unordered_map<void*, std::string> cache;
+	InternalScope scope;
+	std::lock_guard<std::mutex> lock(mutex);
+	const auto it = cache.find(address);
+	if (it != cache.end())
+		return it->second;
+
+	std::stringstream ss;
+#if defined(GTEST_POLICY_EXECINFO_AVAILABLE)
+	Dl_info info;
+	const bool found = dladdr(address, &info) != 0;
+	if (found && info.dli_sname != nullptr)
+	{
+		int status = 0;
+		char* demangled = abi::__cxa_demangle(
+			info.dli_sname, nullptr, nullptr, &status);
+		ss << (status == 0 ? demangled : info.dli_sname) << "+0x" << std::hex
+			<< (static_cast<char*>(address) - static_cast<char*>(info.dli_saddr));
+		std::free(demangled);
+	}
+	else if (found && info.dli_fname != nullptr)
+	{
+		// No exported symbol, e.g. executable not linked with -rdynamic.
+		// Module offset may be resolved via addr2line.
+		ss << info.dli_fname << "+0x" << std::hex
+			<< (static_cast<char*>(address) - static_cast<char*>(info.dli_fbase));
+	}
+#elif defined(GTEST_POLICY_DBGHELP_AVAILABLE)
+	static const bool initialized =
+		SymInitialize(GetCurrentProcess(), nullptr, TRUE) != FALSE;
+	if (initialized)
+	{
+		char buffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME * sizeof(TCHAR)];
+		auto symbol = reinterpret_cast<PSYMBOL_INFO>(buffer);
+		symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+		symbol->MaxNameLen = MAX_SYM_NAME;
+		DWORD64 displacement = 0;
+		const auto addr = reinterpret_cast<DWORD64>(address);
+		if (SymFromAddr(GetCurrentProcess(), addr, &displacement, symbol))
+			ss << symbol->Name << "+0x" << std::hex << displacement << std::dec;
+
+		IMAGEHLP_LINE64 line;
+		line.SizeOfStruct = sizeof(IMAGEHLP_LINE64);
+		DWORD line_displacement = 0;
+		if (SymGetLineFromAddr64(GetCurrentProcess(), addr,
+			&line_displacement, &line))
+			ss << " (" << line.FileName << ":" << line.LineNumber << ")";
+	}
+#endif
+	ss << " [" << address << "]";
+	return cache.emplace(address, ss.str()).first->second;
+}
+
+std::size_t gtest_policies::detail::CallSiteTable::Record(
+	std::size_t bytes, const void* caller) noexcept
+{
+	if (caller == nullptr)
+		return RecordCallStack(bytes, caller);
+	if (!call_stacks_supported)
+		return npos;
+
+	void* const key[] = { const_cast<void*>(caller) };
+	const auto hash = HashFrames(key, 1u);
+	auto index = static_cast<std::size_t>(hash) & (capacity - 1u);
+	for (std::size_t probe = 0; probe < max_probes; ++probe)
+	{
+		auto& entry = entries_[index];
+		auto current = entry.hash.load(std::memory_order_acquire);
+		if (current == 0u && entry.hash.compare_exchange_strong(
+			current, hash, std::memory_order_acq_rel))
+		{
+			// First occurrence of caller, occurrences on other threads are 
+			// counted before the frames have been published via depth
+			void* frames[max_depth];
+			const auto depth = CaptureCallStack(frames, max_depth, caller);
+			for (std::size_t i = 0; i < depth; ++i)
+				entry.frames[i] = frames[i];
+			entry.depth.store(depth, std::memory_order_release);
+			size_.fetch_add(1u, std::memory_order_relaxed);
+			current = hash;
+		}
+
+		if (current == hash)
+		{
+			entry.count.fetch_add(1u, std::memory_order_relaxed);
+			entry.bytes.fetch_add(bytes, std::memory_order_relaxed);
+			return index;
+		}
+
+		index = (index + 1u) & (capacity - 1u);
+	}
+
+	dropped_.fetch_add(1u, std::memory_order_relaxed);
+	return npos;
+}
+
+std::size_t gtest_policies::detail::CallSiteTable::RecordCallStack(
+	std::size_t bytes, const void* caller) noexcept
+{
+	void* frames[max_depth];
+	const auto depth = CaptureCallStack(frames, max_depth, caller);
+	if (depth == 0u)
+		return npos; // not supported
+
+	const auto hash = HashFrames(frames, depth);
+	auto index = static_cast<std::size_t>(hash) & (capacity - 1u);
+	for (std::size_t probe = 0; probe < max_probes; ++probe)
+	{
+		auto& entry = entries_[index];
+		auto current = entry.hash.load(std::memory_order_acquire);
+		if (current == 0u && entry.hash.compare_exchange_strong(
+			current, hash, std::memory_order_acq_rel))
+		{
+			// Claimed empty entry, frames are published via depth
+			for (std::size_t i = 0; i < depth; ++i)
+				entry.frames[i] = frames[i];
+			entry.depth.store(depth, std::memory_order_release);
+			size_.fetch_add(1u, std::memory_order_relaxed);
+			current = hash;
+		}
+
+		if (current == hash)
+		{
+			entry.count.fetch_add(1u, std::memory_order_relaxed);
+			entry.bytes.fetch_add(bytes, std::memory_order_relaxed);
+			return index;
+		}
+
+		index = (index + 1u) & (capacity - 1u);
+	}
+
+	dropped_.fetch_add(1u, std::memory_order_relaxed);
+	return npos;
+}
+
+void gtest_policies::detail::CallSiteTable::Clear() noexcept
+{
+	if (size_.load(std::memory_order_relaxed) != 0u)
+	{
+		for (auto& entry : entries_)
+		{
+			if (entry.hash.load(std::memory_order_relaxed) == 0u)
+				continue;
+			entry.count.store(0u, std::memory_order_relaxed);
+			entry.bytes.store(0u, std::memory_order_relaxed);
+			entry.depth.store(0u, std::memory_order_relaxed);
+			entry.hash.store(0u, std::memory_order_release);
+		}
+	}
+	size_.store(0u, std::memory_order_relaxed);
+	dropped_.store(0u, std::memory_order_relaxed);
+}
+
+std::size_t gtest_policies::detail::CallSiteTable::TopCallSites(
+	CallSite* sites, std::size_t max_sites) const noexcept
+{
+	std::size_t n = 0u;
+	for (const auto& entry : entries_)
+	{
+		const auto depth = entry.depth.load(std::memory_order_acquire);
+		if (depth == 0u)
+			continue;
+
+		CallSite site = { entry.count.load(std::memory_order_relaxed),
+			entry.bytes.load(std::memory_order_relaxed), depth, entry.frames };
+
+		// Insertion into sorted array of max_sites
+		std::size_t i = n < max_sites ? n++ : max_sites;
+		for (; i > 0u && sites[i - 1u].count < site.count; --i)
+		{
+			if (i < max_sites)
+				sites[i] = sites[i - 1u];
+		}
+		if (i < max_sites)
+			sites[i] = site;
+	}
+	return n;
+}
+
+gtest_policies::detail::CallSite 
+gtest_policies::detail::CallSiteTable::Site(std::size_t index) const noexcept
+{
+	const auto& entry = entries_[index & (capacity - 1u)];
+	CallSite site = { entry.count.load(std::memory_order_relaxed),
+		entry.bytes.load(std::memory_order_relaxed), 
+		entry.depth.load(std::memory_order_acquire), entry.frames };
+	return site;
+}
+
+std::size_t gtest_policies::detail::CallSiteTable::Size() const noexcept
+{
+	return size_.load(std::memory_order_relaxed);
+}
+
+std::size_t gtest_policies::detail::CallSiteTable::Dropped() const noexcept
+{
+	return dropped_.load(std::memory_order_relaxed);
+}
+
+bool gtest_policies::detail::DescribeCallSites(ReportBuffer& report,
+	const CallSiteTable& table, const char* what, std::size_t max_sites)
+{
+	const std::size_t max_reported = 8u;
+	CallSite sites[max_reported];
+	const auto n = table.TopCallSites(sites,
+		max_sites < max_reported ? max_sites : max_reported);
+	return DescribeCallSites(report, sites, n, table.Size(), 
+		table.Dropped(), what);
+}
+
+bool gtest_policies::detail::DescribeCallSites(ReportBuffer& report, 
+	const CallSite* sites, std::size_t n, std::size_t total, 
+	std::size_t dropped, const char* what)
+{
+	const std::size_t max_reported_frames = 8u;
+	if (n == 0u)
+		return false;
+
+	auto& ss = report;
+	ss << "\nTop " << n << " of " << total << " " << what
+		<< " call site(s):\n";
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		ss << "#" << (i + 1u) << ": " << sites[i].count << " " << what << "(s)";
+		if (sites[i].bytes != 0u)
+			ss << ", " << sites[i].bytes << " byte(s)";
+		ss << "\n";
+		for (std::size_t frame = 0; frame < sites[i].depth &&
+			frame < max_reported_frames; ++frame)
+			ss << "    at " << Symbolize(sites[i].frames[frame]) << "\n";
+	}
+	if (dropped != 0u)
+	{
+		ss << dropped << " " << what << "(s) not recorded since "
+			"call site table is full.\n";
+	}
+	return true;
+}
@@ -0,0 +1,111 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+#ifndef GTEST_POLICY_CALLSTACK_H
+#define GTEST_POLICY_CALLSTACK_H
+
+#include <atomic>  // std::atomic
+#include <cstddef> // std::size_t
+#include <cstdint> // std::uint64_t
+#include <string>  // std::string
+
+namespace gtest_policies
+{
+namespace detail
+{
+	class ReportBuffer;
+
+	// Captures the call stack of the calling thread into frames. If caller is
+	// found among the captured return addresses, frames above it are omitted,
+	// which hides the interception function itself. Returns the number of
+	// frames captured, zero if not supported on this platform.
+	// Does not allocate memory once WarmUpCallStackCapture() has been called.
+	std::size_t CaptureCallStack(void** frames, std::size_t max_frames,
+		const void* caller) noexcept;
+
+	// Performs any lazy initialization of the platform unwinder, which might
+	// allocate memory, ahead of capturing call stacks from allocation hooks.
+	void WarmUpCallStackCapture() noexcept;
+
+	// Returns a human readable description of a code address. Results are
+	// cached since symbolization is expensive.
+	const std::string& Symbolize(void* address);
+
+	struct CallSite
+	{
+		std::size_t count;
+		std::size_t bytes;
+		std::size_t depth;
+		void* const* frames;
+	};
+
+	// Preallocated lock-free hash table of call sites. Recording neither 
+	// blocks nor allocates, instead call sites are dropped if the table is 
+	// full.
+	class CallSiteTable
+	{
+	public:
+		static const std::size_t capacity = 512u; // power of two
+		static const std::size_t max_depth = 16u;
+		static const std::size_t max_probes = 64u;
+		static const std::size_t npos = capacity;
+
+		// Records an occurrence keyed by the return address caller and 
+		// returns the index of its entry, or npos if not supported or the 
+		// table is full. The call stack is only captured the first time 
+		// caller is recorded, since unwinding is far more expensive than the
+		// hooks recording call sites, hence occurrences of caller reached via
+		// different call paths are attributed to the first one. If caller is
+		// nullptr this is equivalent to RecordCallStack().
+		std::size_t Record(std::size_t bytes, const void* caller) noexcept;
+
+		// Records the call stack of the calling thread keyed by a hash of all
+		// its return addresses, i.e. captures the call stack on every call.
+		std::size_t RecordCallStack(std::size_t bytes, 
+			const void* caller) noexcept;
+		void Clear() noexcept;
+
+		// Returns the call site recorded at index.
+		CallSite Site(std::size_t index) const noexcept;
+
+		// Fills sites with up to max_sites call sites having the highest
+		// count, in descending order. Returns number of sites filled.
+		std::size_t TopCallSites(CallSite* sites,
+			std::size_t max_sites) const noexcept;
+
+		std::size_t Size() const noexcept;
+		std::size_t Dropped() const noexcept;
+
+	private:
+		struct Entry
+		{
+			std::atomic<std::uint64_t> hash;
+			std::atomic<std::size_t> count;
+			std::atomic<std::size_t> bytes;
+			std::atomic<std::size_t> depth;
+			void* frames[max_depth];
+		};
+
+		Entry entries_[capacity];
+		std::atomic<std::size_t> size_;
+		std::atomic<std::size_t> dropped_;
+	};
+
+	// Appends the top call sites of table including symbolized call stacks
+	// to report, preceded by a line break. Returns false without appending
+	// anything if no call sites have been recorded.
+	bool DescribeCallSites(ReportBuffer& report, const CallSiteTable& table,
+		const char* what, std::size_t max_sites);
+
+	// Appends n sites out of total call sites including symbolized call
+	// stacks to report, where dropped is the number of occurrences not 
+	// recorded. Returns false without appending anything if n is zero.
+	bool DescribeCallSites(ReportBuffer& report, const CallSite* sites, 
+		std::size_t n, std::size_t total, std::size_t dropped, 
+		const char* what);
+
+} // namespace gtest_policies::detail
+} // namespace gtest_policies
+
+#endif // GTEST_POLICY_CALLSTACK_H
@@ -4,13 +4,37 @@
 
 #include <gtest_policies/gtest_policies.h>
 
+#include "gtest_policies-internal.h"
+
 gtest_policies::PolicyContext::PolicyContext(
 	listener::PolicyListener* listener, bool is_denied_by_default) noexcept : 
 	listener_(listener), 
+	budget_(),
 	denied_(is_denied_by_default), 
+	scope_(ThreadScope::all_threads),
 	denied_by_default_(is_denied_by_default)
 { }
 
+gtest_policies::PolicyContext::PolicyContext(
+	const PolicyContext& other) noexcept :
+	listener_(other.listener_),
+	budget_(other.budget_),
+	denied_(other.IsDenied()),
+	scope_(other.Scope()),
+	denied_by_default_(other.denied_by_default_)
+{ }
+
+gtest_policies::PolicyContext& gtest_policies::PolicyContext::operator=(
+	const PolicyContext& other) noexcept
+{
+	listener_ = other.listener_;
+	budget_ = other.budget_;
+	denied_.store(other.IsDenied(), std::memory_order_relaxed);
+	scope_.store(other.Scope(), std::memory_order_relaxed);
+	denied_by_default_ = other.denied_by_default_;
+	return *this;
+}
+
 void gtest_policies::PolicyContext::Deny() noexcept
 {
 	SetDenied(true);
@@ -31,34 +55,101 @@ void gtest_policies::PolicyContext::Apply() noexcept
 void gtest_policies::PolicyContext::SetDenied(bool denied) noexcept
 {
 	const auto listener_ptr = listener_;
-	if (listener_ptr != nullptr && listener_->in_test_scope_)
+	if (listener_ptr != nullptr && 
+		listener_ptr->in_test_scope_.load(std::memory_order_relaxed))
 	{
-		const auto previously_denied = denied_;
-		denied_ = denied;
-		if (listener_ptr->in_test_scope_ && previously_denied != denied)
+		// Only the thread changing the state notifies the listener
+		const auto previously_denied = denied_.exchange(
+			denied, std::memory_order_acq_rel);
+		if (previously_denied != denied)
 			listener_ptr->OnPolicyChangeDuringTest(denied);
 	}
 	else
 	{
-		denied_ = denied;
+		denied_.store(denied, std::memory_order_release);
 	}
 }
 
+void gtest_policies::PolicyContext::SetBudget(
+	std::uint64_t count, std::uint64_t bytes) noexcept
+{
+	budget_.metrics[0] = count;
+	budget_.metrics[1] = bytes;
+}
+
+void gtest_policies::PolicyContext::SetBudget(
+	const detail::PolicyUsage& budget) noexcept
+{
+	budget_ = budget;
+}
+
+gtest_policies::TimePolicyContext::TimePolicyContext(
+	listener::PolicyListener* listener, bool is_denied_by_default) noexcept :
+	PolicyContext(listener, is_denied_by_default)
+{ }
+
+void gtest_policies::TimePolicyContext::SetBudget(
+	std::chrono::nanoseconds wall_time, 
+	std::chrono::nanoseconds cpu_time) noexcept
+{
+	const auto to_limit = [](std::chrono::nanoseconds t) -> std::uint64_t {
+		if (t == std::chrono::nanoseconds::max())
+			return unlimited;
+		return t.count() > 0 ? static_cast<std::uint64_t>(t.count()) : 0u;
+	};
+	SetLimit(0u, to_limit(wall_time));
+	SetLimit(1u, to_limit(cpu_time));
+}
+
+void gtest_policies::PolicyContext::SetLimit(
+	std::size_t metric, std::uint64_t limit) noexcept
+{
+	if (metric < detail::PolicyUsage::max_metrics)
+		budget_.metrics[metric] = limit;
+}
+
+std::uint64_t gtest_policies::PolicyContext::Limit(
+	std::size_t metric) const noexcept
+{
+	if (metric < detail::PolicyUsage::max_metrics)
+		return budget_.metrics[metric];
+	return 0u;
+}
+
+const gtest_policies::detail::PolicyUsage& 
+gtest_policies::PolicyContext::Budget() const noexcept
+{
+	return budget_;
+}
+
+void gtest_policies::PolicyContext::SetThreadScope(ThreadScope scope) noexcept
+{
+	scope_.store(scope, std::memory_order_relaxed);
+}
+
+gtest_policies::ThreadScope 
+gtest_policies::PolicyContext::Scope() const noexcept
+{
+	return scope_.load(std::memory_order_relaxed);
+}
+
 void gtest_policies::PolicyContext::Reset() noexcept
 {
-	denied_ = denied_by_default_;
+	denied_.store(denied_by_default_, std::memory_order_release);
+	scope_.store(ThreadScope::all_threads, std::memory_order_relaxed);
+	budget_ = detail::PolicyUsage();
 }
 
 bool gtest_policies::PolicyContext::IsDenied() const noexcept
 {
-	return denied_;
+	return denied_.load(std::memory_order_acquire);
 }
 
 bool gtest_policies::PolicyContext::IsViolated() const noexcept
 {
 	auto ptr = listener_;
 	if (ptr != nullptr)
-		return listener_->violated_;
+		return ptr->violated_.load(std::memory_order_relaxed);
 	return false;
 }
 
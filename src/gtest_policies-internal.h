@@ -0,0 +1,186 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+#ifndef GTEST_POLICY_INTERNAL_H
+#define GTEST_POLICY_INTERNAL_H
+
+#include <gtest_policies/gtest_policies.h>
+
+#include <atomic>  // std::atomic
+#include <cstdint> // std::uint64_t
+#include <cstdio>  // std::snprintf
+#include <cstdlib> // std::getenv, std::free
+#include <string>  // std::string
+
+#if defined(__GLIBC__)
+  #include <dlfcn.h> // dlsym, RTLD_NEXT
+
+  // The initial-exec TLS model guarantees that accessing thread local state
+  // from interposed functions never calls back into the allocator.
+  #define GTEST_POLICY_TLS_INITIAL_EXEC __attribute__((tls_model("initial-exec")))
+#else
+  #define GTEST_POLICY_TLS_INITIAL_EXEC
+#endif // defined(__GLIBC__)
+
+namespace testing
+{
+	class TestInfo;
+}
+
+namespace gtest_policies
+{
+	class PolicyContext;
+
+namespace detail
+{
+	// Registry of policies having an attached listener, i.e. the policies
+	// applied by gtest_policies::Apply(). Listeners register their policy 
+	// when the test program starts and unregister it when destroyed. 
+	// Registering an already registered policy has no effect.
+	void RegisterPolicy(PolicyContext& policy) noexcept;
+	void UnregisterPolicy(PolicyContext& policy) noexcept;
+
+	// Invokes func for each registered policy in order of registration.
+	void ForEachPolicy(void (*func)(PolicyContext& policy)) noexcept;
+
+	// Per-test metrics exported when the test program ends, see 
+	// gtest_policies::SetMetricsOutput(), or compared against a baseline, 
+	// see gtest_policies::SetBaseline(). Listeners record the metrics of a 
+	// test when it ends, the elapsed time of the test is recorded along with
+	// the first metric. WriteMetrics() writes the output, or rewrites the 
+	// baseline, once.
+	bool IsMetricsEnabled();
+	void RecordMetric(const ::testing::TestInfo& test_info, const char* name,
+		std::uint64_t value);
+	void WriteMetrics();
+
+	// Loads the baseline, if any, unless already loaded.
+	void LoadBaseline();
+
+	// Returns true if value of metric name exceeds the baseline value of the
+	// test by more than the tolerance, which is returned via baseline_value.
+	// Tests are not compared while rewriting the baseline.
+	bool ExceedsBaseline(const ::testing::TestInfo& test_info, 
+		const char* name, std::uint64_t value, std::uint64_t& baseline_value);
+	double BaselineTolerance();
+
+	// Non-zero while the calling thread performs work internal to this 
+	// library, e.g. forwarding redirected output, which is not accounted to
+	// the running test by policy monitors.
+	extern thread_local int internal_scope GTEST_POLICY_TLS_INITIAL_EXEC;
+
+	class InternalScope
+	{
+	public:
+		InternalScope() noexcept { ++internal_scope; }
+		~InternalScope() noexcept { --internal_scope; }
+		InternalScope(const InternalScope&) = delete;
+		InternalScope& operator=(const InternalScope&) = delete;
+	};
+
+	inline bool IsInternalScope() noexcept
+	{
+		return internal_scope != 0;
+	}
+
+	// Thread scope of the calling thread, see gtest_policies::ThreadScope.
+	// A new test thread scope begins when a test starts. The thread running 
+	// the test enters it when applying or denying a policy and threads it 
+	// creates inherit it.
+	struct ThreadScopeState
+	{
+		std::uint64_t test; // test thread scope the thread belongs to
+		bool spawned;       // created by a thread of the test
+	};
+
+	extern std::atomic<std::uint64_t> test_thread_scope;
+	extern thread_local ThreadScopeState thread_scope_state
+		GTEST_POLICY_TLS_INITIAL_EXEC;
+
+	inline void BeginTestThreadScope() noexcept
+	{
+		test_thread_scope.fetch_add(1u, std::memory_order_relaxed);
+	}
+
+	inline void EnterTestThreadScope() noexcept
+	{
+		thread_scope_state.test = 
+			test_thread_scope.load(std::memory_order_relaxed);
+		thread_scope_state.spawned = false;
+	}
+
+	inline bool IsInThreadScope(ThreadScope scope) noexcept
+	{
+		if (scope == ThreadScope::all_threads)
+			return true;
+		const auto& state = thread_scope_state;
+		return state.test == test_thread_scope.load(std::memory_order_relaxed) &&
+			(scope == ThreadScope::test_threads || !state.spawned);
+	}
+
+	// Returns the value of environment variable name, or an empty string if
+	// not set.
+	inline std::string GetEnv(const char* name)
+	{
+#if defined(_MSC_VER)
+		char* value = nullptr;
+		std::size_t length = 0u;
+		if (_dupenv_s(&value, &length, name) != 0 || value == nullptr)
+			return std::string();
+		std::string result(value);
+		std::free(value);
+		return result;
+#else
+		const char* value = std::getenv(name);
+		return value != nullptr ? std::string(value) : std::string();
+#endif
+	}
+
+	// Appends text to json as a quoted and escaped JSON string.
+	inline void AppendJsonString(std::string& json, const char* text)
+	{
+		json += '"';
+		for (; *text != '\0'; ++text)
+		{
+			const auto c = static_cast<unsigned char>(*text);
+			if (c == '"' || c == '\\')
+			{
+				json += '\\';
+				json += static_cast<char>(c);
+			}
+			else if (c < 0x20u)
+			{
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				json += escaped;
+			}
+			else
+			{
+				json += static_cast<char>(c);
+			}
+		}
+		json += '"';
+	}
+
+#if defined(__GLIBC__)
+	// Resolves the next definition of a function interposed by this library,
+	// i.e. the libc implementation, once and caches it in next.
+	inline void* NextSymbol(std::atomic<void*>& next, const char* name) noexcept
+	{
+		auto func = next.load(std::memory_order_acquire);
+		if (func == nullptr)
+		{
+			func = dlsym(RTLD_NEXT, name);
+			if (func == nullptr)
+				std::abort(); // libc function not found
+			next.store(func, std::memory_order_release);
+		}
+		return func;
+	}
+#endif // defined(__GLIBC__)
+
+} // namespace gtest_policies::detail
+} // namespace gtest_policies
+
+#endif // GTEST_POLICY_INTERNAL_H
@@ -0,0 +1,454 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+// Fortified inline wrappers would conflict with the interposed functions. 
+// Code under test built with _FORTIFY_SOURCE calls the checked variants, 
+// e.g. __read_chk, which are interposed as well.
+#ifdef _FORTIFY_SOURCE
+  #undef _FORTIFY_SOURCE
+#endif // _FORTIFY_SOURCE
+
+#include <gtest_policies/gtest_policies.h>
+
+#include "gtest_policies-internal.h"
+
+#include <atomic> // std::atomic
+
+#if defined(__GLIBC__) && defined(__LP64__) && \
+    !defined(GTEST_POLICY_DISABLE_IO_HOOKS)
+  // Functions are interposed by defining them in the executable and 
+  // forwarding to the next definition, i.e. libc, found via dlsym. Note that
+  // calls made internally by libc are not intercepted, e.g. the write made 
+  // by fwrite or printf when the stream buffer is full, hence explicit 
+  // flushes of C streams are intercepted instead. Restricted to LP64 where 
+  // 64-bit file offset variants are plain aliases.
+  #define GTEST_POLICY_IO_HOOKS_AVAILABLE
+  #include <cstdarg>      // va_list
+  #include <cstdio>       // FILE, fopen, fflush, fclose
+  #include <fcntl.h>      // open, openat
+  #include <poll.h>       // poll, ppoll
+  #include <stdio_ext.h>  // __fpending
+  #include <sys/epoll.h>  // epoll_wait
+  #include <sys/select.h> // select
+  #include <sys/socket.h> // send, recv
+  #include <sys/uio.h>    // readv, writev
+  #include <unistd.h>     // read, write, fsync
+#else
+  #ifndef GTEST_POLICY_SILENCE_WARNINGS
+    #pragma message ( \
+      "WARNING: gtest_policy::blocking_io policy." \
+      "Blocking I/O detection not supported on this compiler/platform.")
+  #endif // GTEST_POLICY_SILENCE_WARNINGS
+#endif
+
+namespace gtest_policies
+{
+	enum class IoCall
+	{
+		open, read, write, fsync, send, recv, poll
+	};
+
+	static const std::size_t io_call_count = 7u;
+
+	static const char* const io_call_names[io_call_count] = {
+		"open", "read", "write", "fsync", "send", "recv", "poll"
+	};
+
+	// Calls per type while denied, accumulated since the test started
+	static std::uint64_t io_test_calls[io_call_count];
+
+#ifdef GTEST_POLICY_IO_HOOKS_AVAILABLE
+	struct IoCounters
+	{
+		std::atomic<std::uint64_t> calls[io_call_count];
+		std::atomic<std::uint64_t> bytes;
+	};
+
+	// Calls are only counted while monitoring
+	static std::atomic<bool> io_monitoring(false);
+	static IoCounters io_counters;
+
+	static inline void CountIo(IoCall call, long long result) noexcept
+	{
+		if (!io_monitoring.load(std::memory_order_relaxed) || 
+			detail::IsInternalScope() ||
+			!detail::IsInThreadScope(blocking_io.Scope()))
+			return;
+		io_counters.calls[static_cast<std::size_t>(call)].fetch_add(
+			1u, std::memory_order_relaxed);
+		if (result > 0)
+		{
+			io_counters.bytes.fetch_add(static_cast<std::uint64_t>(result),
+				std::memory_order_relaxed);
+		}
+	}
+#endif // GTEST_POLICY_IO_HOOKS_AVAILABLE
+
+	class BlockingIoMonitor : public detail::PolicyMonitor
+	{
+	public:
+		BlockingIoMonitor()
+			: usage_()
+		{ }
+
+		void Start() override
+		{
+#ifdef GTEST_POLICY_IO_HOOKS_AVAILABLE
+			for (auto& calls : io_counters.calls)
+				calls.store(0u, std::memory_order_relaxed);
+			io_counters.bytes.store(0u, std::memory_order_relaxed);
+			io_monitoring.store(true, std::memory_order_seq_cst);
+#endif // GTEST_POLICY_IO_HOOKS_AVAILABLE
+		}
+
+		bool Stop() override
+		{
+			usage_ = detail::PolicyUsage();
+#ifdef GTEST_POLICY_IO_HOOKS_AVAILABLE
+			io_monitoring.store(false, std::memory_order_seq_cst);
+			for (std::size_t i = 0; i < io_call_count; ++i)
+			{
+				const auto calls = io_counters.calls[i].load(
+					std::memory_order_relaxed);
+				io_test_calls[i] += calls;
+				usage_.metrics[0] += calls;
+			}
+			usage_.metrics[1] = io_counters.bytes.load(
+				std::memory_order_relaxed);
+#endif // GTEST_POLICY_IO_HOOKS_AVAILABLE
+			return usage_.metrics[0] != 0u;
+		}
+
+		detail::PolicyUsage Usage() const override
+		{
+			return usage_;
+		}
+
+		void Reset() override
+		{
+			for (auto& calls : io_test_calls)
+				calls = 0u;
+		}
+
+	private:
+		detail::PolicyUsage usage_;
+	};
+}
+
+#ifdef GTEST_POLICY_IO_HOOKS_AVAILABLE
+
+extern "C"
+{
+	// Checked variants called by code built with _FORTIFY_SOURCE if the 
+	// buffer size is known at compile time, declared by glibc only when
+	// fortified.
+	ssize_t __read_chk(int fd, void* buf, size_t count, size_t buflen);
+	ssize_t __pread_chk(int fd, void* buf, size_t count, off_t offset, 
+		size_t buflen);
+	ssize_t __pread64_chk(int fd, void* buf, size_t count, off64_t offset, 
+		size_t buflen);
+	ssize_t __recv_chk(int fd, void* buf, size_t len, size_t buflen, 
+		int flags);
+	ssize_t __recvfrom_chk(int fd, void* buf, size_t len, size_t buflen, 
+		int flags, struct sockaddr* addr, socklen_t* addrlen);
+	int __poll_chk(struct pollfd* fds, nfds_t nfds, int timeout, 
+		size_t fdslen);
+	int __ppoll_chk(struct pollfd* fds, nfds_t nfds, 
+		const struct timespec* timeout, const sigset_t* sigmask, 
+		size_t fdslen);
+}
+
+// Mode is only passed if a file may be created
+#define GTEST_POLICY_IO_OPEN_MODE(flags) \
+	mode_t mode = 0; \
+	if (((flags) & O_CREAT) != 0 || ((flags) & O_TMPFILE) == O_TMPFILE) \
+	{ \
+		va_list args; \
+		va_start(args, flags); \
+		mode = static_cast<mode_t>(va_arg(args, int)); \
+		va_end(args); \
+	}
+
+// Forwards a call to the next definition of name and counts it as call
+#define GTEST_POLICY_IO_FORWARD(call, name, ...) \
+	static std::atomic<void*> next(nullptr); \
+	const auto result = reinterpret_cast<decltype(&name)>( \
+		gtest_policies::detail::NextSymbol(next, #name))(__VA_ARGS__); \
+	gtest_policies::CountIo(gtest_policies::IoCall::call, \
+		static_cast<long long>(result)); \
+	return result
+
+extern "C" int open(const char* path, int flags, ...)
+{
+	GTEST_POLICY_IO_OPEN_MODE(flags);
+	GTEST_POLICY_IO_FORWARD(open, open, path, flags, mode);
+}
+
+extern "C" int open64(const char* path, int flags, ...)
+{
+	GTEST_POLICY_IO_OPEN_MODE(flags);
+	GTEST_POLICY_IO_FORWARD(open, open64, path, flags, mode);
+}
+
+extern "C" int openat(int dirfd, const char* path, int flags, ...)
+{
+	GTEST_POLICY_IO_OPEN_MODE(flags);
+	GTEST_POLICY_IO_FORWARD(open, openat, dirfd, path, flags, mode);
+}
+
+extern "C" int openat64(int dirfd, const char* path, int flags, ...)
+{
+	GTEST_POLICY_IO_OPEN_MODE(flags);
+	GTEST_POLICY_IO_FORWARD(open, openat64, dirfd, path, flags, mode);
+}
+
+extern "C" FILE* fopen(const char* path, const char* mode)
+{
+	static std::atomic<void*> next(nullptr);
+	FILE* file = reinterpret_cast<decltype(&fopen)>(
+		gtest_policies::detail::NextSymbol(next, "fopen"))(path, mode);
+	gtest_policies::CountIo(gtest_policies::IoCall::open, 0);
+	return file;
+}
+
+extern "C" FILE* fopen64(const char* path, const char* mode)
+{
+	static std::atomic<void*> next(nullptr);
+	FILE* file = reinterpret_cast<decltype(&fopen64)>(
+		gtest_policies::detail::NextSymbol(next, "fopen64"))(path, mode);
+	gtest_policies::CountIo(gtest_policies::IoCall::open, 0);
+	return file;
+}
+
+extern "C" ssize_t read(int fd, void* buf, size_t count)
+{
+	GTEST_POLICY_IO_FORWARD(read, read, fd, buf, count);
+}
+
+extern "C" ssize_t __read_chk(int fd, void* buf, size_t count, size_t buflen)
+{
+	GTEST_POLICY_IO_FORWARD(read, __read_chk, fd, buf, count, buflen);
+}
+
+extern "C" ssize_t pread(int fd, void* buf, size_t count, off_t offset)
+{
+	GTEST_POLICY_IO_FORWARD(read, pread, fd, buf, count, offset);
+}
+
+extern "C" ssize_t pread64(int fd, void* buf, size_t count, off64_t offset)
+{
+	GTEST_POLICY_IO_FORWARD(read, pread64, fd, buf, count, offset);
+}
+
+extern "C" ssize_t __pread_chk(int fd, void* buf, size_t count, off_t offset,
+	size_t buflen)
+{
+	GTEST_POLICY_IO_FORWARD(read, __pread_chk, fd, buf, count, offset, buflen);
+}
+
+extern "C" ssize_t __pread64_chk(int fd, void* buf, size_t count, 
+	off64_t offset, size_t buflen)
+{
+	GTEST_POLICY_IO_FORWARD(read, __pread64_chk, 
+		fd, buf, count, offset, buflen);
+}
+
+extern "C" ssize_t readv(int fd, const struct iovec* iov, int iovcnt)
+{
+	GTEST_POLICY_IO_FORWARD(read, readv, fd, iov, iovcnt);
+}
+
+extern "C" ssize_t write(int fd, const void* buf, size_t count)
+{
+	GTEST_POLICY_IO_FORWARD(write, write, fd, buf, count);
+}
+
+extern "C" ssize_t pwrite(int fd, const void* buf, size_t count, off_t offset)
+{
+	GTEST_POLICY_IO_FORWARD(write, pwrite, fd, buf, count, offset);
+}
+
+extern "C" ssize_t pwrite64(int fd, const void* buf, size_t count, 
+	off64_t offset)
+{
+	GTEST_POLICY_IO_FORWARD(write, pwrite64, fd, buf, count, offset);
+}
+
+extern "C" ssize_t writev(int fd, const struct iovec* iov, int iovcnt)
+{
+	GTEST_POLICY_IO_FORWARD(write, writev, fd, iov, iovcnt);
+}
+
+// Explicit flushes of C streams, e.g. flushing a log file, are counted as a
+// write of the pending bytes if any. Writes made by libc when the stream 
+// buffer is full are not intercepted.
+extern "C" int fflush(FILE* stream)
+{
+	static std::atomic<void*> next(nullptr);
+	const auto pending = stream != nullptr ? __fpending(stream) : 0u;
+	const auto result = reinterpret_cast<decltype(&fflush)>(
+		gtest_policies::detail::NextSymbol(next, "fflush"))(stream);
+	if (pending != 0u && result == 0)
+	{
+		gtest_policies::CountIo(gtest_policies::IoCall::write, 
+			static_cast<long long>(pending));
+	}
+	return result;
+}
+
+extern "C" int fclose(FILE* stream)
+{
+	static std::atomic<void*> next(nullptr);
+	const auto pending = __fpending(stream);
+	const auto result = reinterpret_cast<decltype(&fclose)>(
+		gtest_policies::detail::NextSymbol(next, "fclose"))(stream);
+	if (pending != 0u)
+	{
+		gtest_policies::CountIo(gtest_policies::IoCall::write, 
+			static_cast<long long>(pending));
+	}
+	return result;
+}
+
+extern "C" int fsync(int fd)
+{
+	GTEST_POLICY_IO_FORWARD(fsync, fsync, fd);
+}
+
+extern "C" int fdatasync(int fd)
+{
+	GTEST_POLICY_IO_FORWARD(fsync, fdatasync, fd);
+}
+
+extern "C" ssize_t send(int fd, const void* buf, size_t len, int flags)
+{
+	GTEST_POLICY_IO_FORWARD(send, send, fd, buf, len, flags);
+}
+
+extern "C" ssize_t sendto(int fd, const void* buf, size_t len, int flags,
+	const struct sockaddr* addr, socklen_t addrlen)
+{
+	GTEST_POLICY_IO_FORWARD(send, sendto, fd, buf, len, flags, addr, addrlen);
+}
+
+extern "C" ssize_t sendmsg(int fd, const struct msghdr* msg, int flags)
+{
+	GTEST_POLICY_IO_FORWARD(send, sendmsg, fd, msg, flags);
+}
+
+extern "C" ssize_t recv(int fd, void* buf, size_t len, int flags)
+{
+	GTEST_POLICY_IO_FORWARD(recv, recv, fd, buf, len, flags);
+}
+
+extern "C" ssize_t __recv_chk(int fd, void* buf, size_t len, size_t buflen,
+	int flags)
+{
+	GTEST_POLICY_IO_FORWARD(recv, __recv_chk, fd, buf, len, buflen, flags);
+}
+
+extern "C" ssize_t recvfrom(int fd, void* buf, size_t len, int flags,
+	struct sockaddr* addr, socklen_t* addrlen)
+{
+	GTEST_POLICY_IO_FORWARD(recv, recvfrom, fd, buf, len, flags, addr, addrlen);
+}
+
+extern "C" ssize_t __recvfrom_chk(int fd, void* buf, size_t len, 
+	size_t buflen, int flags, struct sockaddr* addr, socklen_t* addrlen)
+{
+	GTEST_POLICY_IO_FORWARD(recv, __recvfrom_chk, 
+		fd, buf, len, buflen, flags, addr, addrlen);
+}
+
+extern "C" ssize_t recvmsg(int fd, struct msghdr* msg, int flags)
+{
+	GTEST_POLICY_IO_FORWARD(recv, recvmsg, fd, msg, flags);
+}
+
+extern "C" int poll(struct pollfd* fds, nfds_t nfds, int timeout)
+{
+	GTEST_POLICY_IO_FORWARD(poll, poll, fds, nfds, timeout);
+}
+
+extern "C" int ppoll(struct pollfd* fds, nfds_t nfds, 
+	const struct timespec* timeout, const sigset_t* sigmask)
+{
+	GTEST_POLICY_IO_FORWARD(poll, ppoll, fds, nfds, timeout, sigmask);
+}
+
+extern "C" int __poll_chk(struct pollfd* fds, nfds_t nfds, int timeout, 
+	size_t fdslen)
+{
+	GTEST_POLICY_IO_FORWARD(poll, __poll_chk, fds, nfds, timeout, fdslen);
+}
+
+extern "C" int __ppoll_chk(struct pollfd* fds, nfds_t nfds, 
+	const struct timespec* timeout, const sigset_t* sigmask, size_t fdslen)
+{
+	GTEST_POLICY_IO_FORWARD(poll, __ppoll_chk, 
+		fds, nfds, timeout, sigmask, fdslen);
+}
+
+extern "C" int select(int nfds, fd_set* readfds, fd_set* writefds,
+	fd_set* exceptfds, struct timeval* timeout)
+{
+	GTEST_POLICY_IO_FORWARD(poll, select, 
+		nfds, readfds, writefds, exceptfds, timeout);
+}
+
+extern "C" int epoll_wait(int epfd, struct epoll_event* events, 
+	int maxevents, int timeout)
+{
+	GTEST_POLICY_IO_FORWARD(poll, epoll_wait, epfd, events, maxevents, timeout);
+}
+
+#undef GTEST_POLICY_IO_FORWARD
+#undef GTEST_POLICY_IO_OPEN_MODE
+
+#endif // GTEST_POLICY_IO_HOOKS_AVAILABLE
+
+gtest_policies::listener::BlockingIoPolicyListener::BlockingIoPolicyListener()
+	: PolicyListener(blocking_io, std::make_unique<BlockingIoMonitor>())
+{ }
+
+const char* gtest_policies::listener::BlockingIoPolicyListener::MetricName(
+	std::size_t metric) const noexcept
+{
+	static const char* const names[] = { "blocking_io_calls", "blocking_io_bytes" };
+	return metric < sizeof(names) / sizeof(names[0]) ? names[metric] : nullptr;
+}
+
+void gtest_policies::listener::BlockingIoPolicyListener::OnPolicyViolation()
+{
+	const auto& usage = Usage();
+	const auto& budget = Policy().Budget();
+	auto& ss = ViolationReport();
+	ss << "Policy violation: gtest_policy::blocking_io\n";
+	if (budget.metrics[0] == 0u)
+	{
+		ss << "Blocking I/O is not permitted by the test policy for this "
+			"test case. ";
+	}
+	else
+	{
+		ss << "Blocking I/O exceeded the budget permitted by the test policy "
+			"for this test case. ";
+	}
+	ss << "Calls: " << usage.metrics[0]
+		<< " (budget: " << detail::FormatLimit(budget.metrics[0]) << "), "
+		<< "bytes: " << usage.metrics[1]
+		<< " (budget: " << detail::FormatLimit(budget.metrics[1]) << "). "
+		<< "Calls per type:";
+	const char* separator = " ";
+	for (std::size_t i = 0; i < io_call_count; ++i)
+	{
+		if (io_test_calls[i] == 0u)
+			continue;
+		ss << separator << io_call_names[i] << ": " << io_test_calls[i];
+		separator = ", ";
+	}
+	ss << ". Re-run the test case in debug mode with debugger attached and a "
+		"breakpoint on the reported functions to find the origin. ";
+	GTEST_NONFATAL_FAILURE_(ss.c_str());
+}
@@ -4,44 +4,243 @@
 
 #include <gtest_policies/gtest_policies.h>
 
+#include "gtest_policies-internal.h"
+
+#include <cstdio>  // std::snprintf
+#include <cstring> // std::strlen
+
+thread_local int gtest_policies::detail::internal_scope 
+	GTEST_POLICY_TLS_INITIAL_EXEC = 0;
+
+// Zero is never a test thread scope, hence threads not entering a scope are
+// never in scope
+std::atomic<std::uint64_t> gtest_policies::detail::test_thread_scope(1u);
+thread_local gtest_policies::detail::ThreadScopeState 
+	gtest_policies::detail::thread_scope_state 
+	GTEST_POLICY_TLS_INITIAL_EXEC = { 0u, false };
+
+namespace
+{
+	void Accumulate(gtest_policies::detail::PolicyUsage& total,
+		const gtest_policies::detail::PolicyUsage& usage) noexcept
+	{
+		for (std::size_t i = 0; i < usage.max_metrics; ++i)
+			total.metrics[i] += usage.metrics[i];
+	}
+
+	bool IsExceeding(const gtest_policies::detail::PolicyUsage& usage,
+		const gtest_policies::detail::PolicyUsage& budget) noexcept
+	{
+		for (std::size_t i = 0; i < usage.max_metrics; ++i)
+		{
+			if (usage.metrics[i] > budget.metrics[i])
+				return true;
+		}
+		return false;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ReportBuffer
+///////////////////////////////////////////////////////////////////////////////
+
+gtest_policies::detail::ReportBuffer::ReportBuffer() noexcept
+	: size_(0u), truncated_(false)
+{
+	buffer_[0] = '\0';
+}
+
+void gtest_policies::detail::ReportBuffer::Clear() noexcept
+{
+	size_ = 0u;
+	truncated_ = false;
+	buffer_[0] = '\0';
+}
+
+void gtest_policies::detail::ReportBuffer::Append(
+	const char* text, std::size_t length) noexcept
+{
+	if (truncated_)
+		return;
+
+	const auto available = capacity - 1u - size_;
+	if (length > available)
+	{
+		// Mark truncation by ending the report with an ellipsis
+		static const char ellipsis[] = "...";
+		const std::size_t ellipsis_length = sizeof(ellipsis) - 1u;
+		std::memcpy(buffer_ + size_, text, available);
+		std::memcpy(buffer_ + capacity - 1u - ellipsis_length, 
+			ellipsis, ellipsis_length);
+		size_ = capacity - 1u;
+		truncated_ = true;
+	}
+	else
+	{
+		std::memcpy(buffer_ + size_, text, length);
+		size_ += length;
+	}
+	buffer_[size_] = '\0';
+}
+
+const char* gtest_policies::detail::ReportBuffer::c_str() const noexcept
+{
+	return buffer_;
+}
+
+std::size_t gtest_policies::detail::ReportBuffer::size() const noexcept
+{
+	return size_;
+}
+
+bool gtest_policies::detail::ReportBuffer::truncated() const noexcept
+{
+	return truncated_;
+}
+
+gtest_policies::detail::ReportBuffer& 
+gtest_policies::detail::ReportBuffer::operator<<(const char* text) noexcept
+{
+	Append(text, std::strlen(text));
+	return *this;
+}
+
+gtest_policies::detail::ReportBuffer& 
+gtest_policies::detail::ReportBuffer::operator<<(const std::string& text) noexcept
+{
+	Append(text.data(), text.size());
+	return *this;
+}
+
+gtest_policies::detail::ReportBuffer& 
+gtest_policies::detail::ReportBuffer::operator<<(char c) noexcept
+{
+	Append(&c, 1u);
+	return *this;
+}
+
+gtest_policies::detail::ReportBuffer& 
+gtest_policies::detail::ReportBuffer::operator<<(unsigned long long value) noexcept
+{
+	char digits[20]; // maximum of 64-bit unsigned
+	std::size_t n = 0u;
+	do
+	{
+		digits[sizeof(digits) - ++n] = static_cast<char>('0' + value % 10u);
+		value /= 10u;
+	} while (value != 0u);
+	Append(digits + sizeof(digits) - n, n);
+	return *this;
+}
+
+gtest_policies::detail::ReportBuffer& 
+gtest_policies::detail::ReportBuffer::operator<<(unsigned long value) noexcept
+{
+	return *this << static_cast<unsigned long long>(value);
+}
+
+gtest_policies::detail::ReportBuffer& 
+gtest_policies::detail::ReportBuffer::operator<<(unsigned int value) noexcept
+{
+	return *this << static_cast<unsigned long long>(value);
+}
+
+gtest_policies::detail::ReportBuffer& 
+gtest_policies::detail::ReportBuffer::operator<<(long long value) noexcept
+{
+	if (value >= 0)
+		return *this << static_cast<unsigned long long>(value);
+	*this << '-';
+	return *this << (0ull - static_cast<unsigned long long>(value));
+}
+
+gtest_policies::detail::ReportBuffer& 
+gtest_policies::detail::ReportBuffer::operator<<(long value) noexcept
+{
+	return *this << static_cast<long long>(value);
+}
+
+gtest_policies::detail::ReportBuffer& 
+gtest_policies::detail::ReportBuffer::operator<<(int value) noexcept
+{
+	return *this << static_cast<long long>(value);
+}
+
+gtest_policies::detail::ReportBuffer& 
+gtest_policies::detail::ReportBuffer::operator<<(Limit limit) noexcept
+{
+	if (limit.value == unlimited)
+		return *this << "unlimited";
+	return *this << static_cast<unsigned long long>(limit.value);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PolicyListener
+///////////////////////////////////////////////////////////////////////////////
+
 gtest_policies::listener::PolicyListener::PolicyListener(
 	PolicyContext& policy, std::unique_ptr<detail::PolicyMonitor>&& monitor) noexcept : 
 	::testing::TestEventListener(), 
-	policy_(policy), 
 	monitor_(std::move(monitor)),
+	policy_(policy),
+	report_(),
+	usage_(),
+	global_budget_(),
+	program_budget_(),
+	stored_budget_(),
+	global_scope_(ThreadScope::all_threads),
+	program_scope_(ThreadScope::all_threads),
+	stored_scope_(ThreadScope::all_threads),
 	global_policy_(false),
 	program_policy_(false), 
 	stored_policy_(false), 
 	violated_(false),
 	in_test_scope_(false),
-	applied_(false)
+	applied_(false),
+	concluded_(false),
+	monitored_(false)
 { }
 
 gtest_policies::listener::PolicyListener::~PolicyListener() noexcept
 {
-	policy_.listener_ = nullptr;
+	if (policy_.listener_ == this)
+	{
+		detail::UnregisterPolicy(policy_);
+		policy_.listener_ = nullptr;
+	}
 }
 
 void gtest_policies::listener::PolicyListener::OnTestProgramStart(
 	const ::testing::UnitTest& /*unit_test*/)
 { 
 	policy_.listener_ = this;
+	detail::RegisterPolicy(policy_);
+	detail::LoadBaseline();
 	global_policy_ = policy_.IsDenied();
+	global_budget_ = policy_.Budget();
+	global_scope_ = policy_.Scope();
 }
 
 void gtest_policies::listener::PolicyListener::OnTestSuiteStart(
 	const ::testing::TestSuite& /*test_suite*/)
 {
 	program_policy_ = policy_.IsDenied();
+	program_budget_ = policy_.Budget();
+	program_scope_ = policy_.Scope();
 }
 
 void gtest_policies::listener::PolicyListener::Apply()
 {
-	if (!applied_)
+	if (!applied_.load(std::memory_order_relaxed))
 	{
-		applied_ = true;
+		detail::InternalScope scope;
+		detail::EnterTestThreadScope();
+		applied_.store(true, std::memory_order_relaxed);
 		if (Policy().IsDenied())
+		{
+			monitored_ = true;
 			monitor_->Start();
+		}
 	}
 }
 
@@ -50,80 +249,178 @@ void gtest_policies::listener::PolicyListener::OnTestStart(
 {
 	// Store policy setting before entering SetUp
 	stored_policy_ = policy_.IsDenied();
+	stored_budget_ = policy_.Budget();
+	stored_scope_ = policy_.Scope();
+
+	// Threads of previous tests are no longer in thread scope
+	detail::BeginTestThreadScope();
 
 	// Entering test scope
-	in_test_scope_ = true;
+	in_test_scope_.store(true, std::memory_order_relaxed);
 
 	// Reset policy if previously violated in previous test
-	violated_ = false;
+	violated_.store(false, std::memory_order_relaxed);
+	concluded_ = false;
+	monitored_ = false;
+	usage_ = detail::PolicyUsage();
+	monitor_->Reset();
 }
 
 void gtest_policies::listener::PolicyListener::StopAndEvaluate()
 {
 	if (monitor_->Stop())
-		ReportViolation();
+		Evaluate();
+}
+
+void gtest_policies::listener::PolicyListener::Evaluate()
+{
+	// Usage is accumulated over all denied periods of the test. Note that 
+	// the policy may already be granted if invoked due to deny ---> grant.
+	Accumulate(usage_, monitor_->Usage());
+	if (in_test_scope_.load(std::memory_order_relaxed) && 
+		IsExceeding(usage_, policy_.Budget()))
+		violated_.store(true, std::memory_order_relaxed);
+}
+
+void gtest_policies::listener::PolicyListener::Conclude()
+{
+	if (concluded_ || !in_test_scope_.load(std::memory_order_relaxed))
+		return;
+	concluded_ = true;
+
+	if (applied_.load(std::memory_order_relaxed))
+	{
+		if (Policy().IsDenied())
+			StopAndEvaluate();
+		if (monitor_->Finish())
+			Evaluate();
+	}
+}
+
+void gtest_policies::listener::PolicyListener::ConcludeAll()
+{
+	detail::ForEachPolicy([](PolicyContext& policy) {
+		const auto listener = policy.listener_;
+		if (listener != nullptr)
+			listener->Conclude();
+	});
 }
 
 void gtest_policies::listener::PolicyListener::OnTestEnd(
-	const ::testing::TestInfo& /*test_info*/ )
+	const ::testing::TestInfo& test_info)
 {
-	if (Policy().IsDenied())
-		StopAndEvaluate();
+	// Reporting, e.g. by other listeners, is not accounted to the test
+	detail::InternalScope scope;
+
+	// Stop monitoring of all policies before any listener reports, since 
+	// Google Test invokes listeners one at a time and reporting allocates.
+	ConcludeAll();
+	Conclude();
 
 	// Only report policy violations if the test has not failed 
 	// due to assertion failure
 	const bool has_failure = ::testing::Test::HasFailure();
-	if (!has_failure && in_test_scope_ && violated_)
+	const bool in_test_scope = in_test_scope_.load(std::memory_order_relaxed);
+	if (!has_failure && in_test_scope && 
+		violated_.load(std::memory_order_relaxed))
 	{
 		OnPolicyViolation();
-
-		//GTEST_NONFATAL_FAILURE_(\
-		//	"Policy violation: gtest_policies::dynamic_memory_allocation\n" \
-		//	"Dynamic memory allocation is not permitted by the test policy " \
-		//	"for this test case. " \
-		//	"Re-run the test case in debug mode with debugger attached to " \
-		//	"break at the allocation causing this policy violation. ");
 	}
 
+	// Export usage of policies monitored during the test, a regression is 
+	// not reported in addition to a policy violation
+	if (in_test_scope && monitored_ && detail::IsMetricsEnabled())
+		RecordMetrics(test_info, ::testing::Test::HasFailure());
+
 	// No longer in test scope
-	in_test_scope_ = false;
+	in_test_scope_.store(false, std::memory_order_relaxed);
 
 	// No longer applied
-	applied_ = false;
+	applied_.store(false, std::memory_order_relaxed);
 	
 	// Restore policy setting from before invoking SetUp or test function
-	RestorePolicy(stored_policy_);
+	RestorePolicy(stored_policy_, stored_budget_, stored_scope_);
+}
+
+void gtest_policies::listener::PolicyListener::RecordMetrics(
+	const ::testing::TestInfo& test_info, bool has_failure)
+{
+	auto& ss = ViolationReport();
+	bool regressed = false;
+	for (std::size_t i = 0; i < usage_.max_metrics; ++i)
+	{
+		const auto name = MetricName(i);
+		if (name == nullptr)
+			continue;
+
+		const auto value = usage_.metrics[i];
+		detail::RecordMetric(test_info, name, value);
+
+		// Only compare if the test has not already failed
+		std::uint64_t baseline = 0u;
+		if (has_failure || 
+			!detail::ExceedsBaseline(test_info, name, value, baseline))
+			continue;
+
+		if (!regressed)
+		{
+			char tolerance[32];
+			std::snprintf(tolerance, sizeof(tolerance), "%g", 
+				detail::BaselineTolerance() * 100.0);
+			ss << "Performance regression compared to baseline (tolerance: "
+				<< tolerance << "%). ";
+			regressed = true;
+		}
+		else
+		{
+			ss << ", ";
+		}
+		ss << name << ": " << value << " (baseline: " << baseline << ")";
+	}
+	if (regressed)
+	{
+		ss << ".";
+		GTEST_NONFATAL_FAILURE_(ss.c_str());
+	}
 }
 
 void gtest_policies::listener::PolicyListener::OnTestSuiteEnd(
 	const ::testing::TestSuite& /*test_suite*/)
 {
-	RestorePolicy(program_policy_);
+	RestorePolicy(program_policy_, program_budget_, program_scope_);
 }
 
 void gtest_policies::listener::PolicyListener::OnTestProgramEnd(
 	const ::testing::UnitTest& /*unit_test*/)
 { 
-	RestorePolicy(global_policy_);
+	RestorePolicy(global_policy_, global_budget_, global_scope_);
+
+	// Written by the first listener, all tests have ended
+	detail::InternalScope scope;
+	detail::WriteMetrics();
 }
 
-void gtest_policies::listener::PolicyListener::RestorePolicy(bool deny) noexcept
+void gtest_policies::listener::PolicyListener::RestorePolicy(
+	bool deny, const detail::PolicyUsage& budget, ThreadScope scope) noexcept
 {
 	if (deny)
 		policy_.Deny();
 	else
 		policy_.Grant();
+	policy_.SetBudget(budget);
+	policy_.SetThreadScope(scope);
 }
 
 void gtest_policies::listener::PolicyListener::ReportViolation()
 {
-	if (in_test_scope_ && policy_.IsDenied() && applied_)
-		violated_ = true;
+	if (in_test_scope_.load(std::memory_order_relaxed) && policy_.IsDenied() && 
+		applied_.load(std::memory_order_relaxed))
+		violated_.store(true, std::memory_order_relaxed);
 }
 
 bool gtest_policies::listener::PolicyListener::IsViolated() const noexcept
 {
-	return violated_;
+	return violated_.load(std::memory_order_relaxed);
 }
 
 const gtest_policies::PolicyContext& gtest_policies::listener::PolicyListener::Policy() const noexcept
@@ -136,13 +433,31 @@ gtest_policies::PolicyContext& gtest_policies::listener::PolicyListener::Policy(
 	return policy_;
 }
 
+const gtest_policies::detail::PolicyUsage& 
+gtest_policies::listener::PolicyListener::Usage() const noexcept
+{
+	return usage_;
+}
+
+gtest_policies::detail::ReportBuffer& 
+gtest_policies::listener::PolicyListener::ViolationReport() noexcept
+{
+	report_.Clear();
+	return report_;
+}
+
 void gtest_policies::listener::PolicyListener::OnPolicyChangeDuringTest(bool deny) noexcept
 {
-	if (!applied_)
+	if (!applied_.load(std::memory_order_relaxed))
 		return; // not applied
 
+	detail::InternalScope scope;
 	if (deny)
+	{
+		detail::EnterTestThreadScope();
+		monitored_ = true;
 		monitor_->Start(); // grant ---> deny
+	}
 	else
 		StopAndEvaluate(); // deny ---> grant
 }
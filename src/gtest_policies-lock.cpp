@@ -0,0 +1,382 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+#include <gtest_policies/gtest_policies.h>
+
+#include "gtest_policies-internal.h"
+
+#include <atomic> // std::atomic
+
+#if defined(__GLIBC__) && defined(__LP64__) && \
+    !defined(GTEST_POLICY_DISABLE_LOCK_HOOKS)
+  // Functions are interposed by defining them in the executable and 
+  // forwarding to the next definition, i.e. libc, found via dlsym. Locks 
+  // taken internally by libc, e.g. by stdio, are not intercepted.
+  #define GTEST_POLICY_LOCK_HOOKS_AVAILABLE
+  #include <cerrno>         // EBUSY
+  #include <linux/futex.h>  // FUTEX_WAIT
+  #include <pthread.h>      // pthread_mutex_lock
+  #include <sys/syscall.h>  // SYS_futex
+#else
+  #ifndef GTEST_POLICY_SILENCE_WARNINGS
+    #pragma message ( \
+      "WARNING: gtest_policy::lock_acquisition policy." \
+      "Lock detection not supported on this compiler/platform.")
+  #endif // GTEST_POLICY_SILENCE_WARNINGS
+#endif
+
+namespace gtest_policies
+{
+	enum class LockCall
+	{
+		mutex, rwlock, futex, condition_variable
+	};
+
+	static const std::size_t lock_call_count = 4u;
+
+	static const char* const lock_call_names[lock_call_count] = {
+		"mutex", "rwlock", "futex", "condition variable"
+	};
+
+	// Calls per type while denied, accumulated since the test started
+	static std::uint64_t lock_test_calls[lock_call_count];
+
+#ifdef GTEST_POLICY_LOCK_HOOKS_AVAILABLE
+	struct LockCounters
+	{
+		std::atomic<std::uint64_t> calls[lock_call_count];
+		std::atomic<std::uint64_t> blocking;
+	};
+
+	// Calls are only counted while monitoring
+	static std::atomic<bool> lock_monitoring(false);
+	static LockCounters lock_counters;
+
+	static inline bool IsMonitoringLocks() noexcept
+	{
+		return lock_monitoring.load(std::memory_order_relaxed) && 
+			!detail::IsInternalScope() &&
+			detail::IsInThreadScope(lock_acquisition.Scope());
+	}
+
+	static inline void CountLock(LockCall call, bool blocking) noexcept
+	{
+		lock_counters.calls[static_cast<std::size_t>(call)].fetch_add(
+			1u, std::memory_order_relaxed);
+		if (blocking)
+			lock_counters.blocking.fetch_add(1u, std::memory_order_relaxed);
+	}
+#endif // GTEST_POLICY_LOCK_HOOKS_AVAILABLE
+
+	class LockMonitor : public detail::PolicyMonitor
+	{
+	public:
+		LockMonitor()
+			: usage_()
+		{ }
+
+		void Start() override
+		{
+#ifdef GTEST_POLICY_LOCK_HOOKS_AVAILABLE
+			for (auto& calls : lock_counters.calls)
+				calls.store(0u, std::memory_order_relaxed);
+			lock_counters.blocking.store(0u, std::memory_order_relaxed);
+			lock_monitoring.store(true, std::memory_order_seq_cst);
+#endif // GTEST_POLICY_LOCK_HOOKS_AVAILABLE
+		}
+
+		bool Stop() override
+		{
+			usage_ = detail::PolicyUsage();
+#ifdef GTEST_POLICY_LOCK_HOOKS_AVAILABLE
+			lock_monitoring.store(false, std::memory_order_seq_cst);
+			for (std::size_t i = 0; i < lock_call_count; ++i)
+			{
+				const auto calls = lock_counters.calls[i].load(
+					std::memory_order_relaxed);
+				lock_test_calls[i] += calls;
+				usage_.metrics[0] += calls;
+			}
+			usage_.metrics[1] = lock_counters.blocking.load(
+				std::memory_order_relaxed);
+#endif // GTEST_POLICY_LOCK_HOOKS_AVAILABLE
+			return usage_.metrics[0] != 0u;
+		}
+
+		detail::PolicyUsage Usage() const override
+		{
+			return usage_;
+		}
+
+		void Reset() override
+		{
+			for (auto& calls : lock_test_calls)
+				calls = 0u;
+		}
+
+	private:
+		detail::PolicyUsage usage_;
+	};
+}
+
+#ifdef GTEST_POLICY_LOCK_HOOKS_AVAILABLE
+
+// Resolves the next definition of name into a local function pointer
+#define GTEST_POLICY_LOCK_NEXT(name) \
+	static std::atomic<void*> next_##name(nullptr); \
+	const auto name##_next = reinterpret_cast<decltype(&name)>( \
+		gtest_policies::detail::NextSymbol(next_##name, #name))
+
+// Acquires a lock, detecting contention by attempting to acquire it without
+// blocking first while monitoring
+#define GTEST_POLICY_LOCK_ACQUIRE(call, name, try_name, ...) \
+	GTEST_POLICY_LOCK_NEXT(name); \
+	if (gtest_policies::IsMonitoringLocks()) \
+	{ \
+		GTEST_POLICY_LOCK_NEXT(try_name); \
+		const auto result = try_name##_next(__VA_ARGS__); \
+		const bool contended = result == EBUSY; \
+		gtest_policies::CountLock(gtest_policies::LockCall::call, contended); \
+		if (!contended) \
+			return result; \
+	} \
+	return name##_next(__VA_ARGS__)
+
+// Forwards a call and counts it if monitoring
+#define GTEST_POLICY_LOCK_FORWARD(call, blocking, name, ...) \
+	GTEST_POLICY_LOCK_NEXT(name); \
+	if (gtest_policies::IsMonitoringLocks()) \
+		gtest_policies::CountLock(gtest_policies::LockCall::call, blocking); \
+	return name##_next(__VA_ARGS__)
+
+extern "C" int pthread_mutex_lock(pthread_mutex_t* mutex) noexcept
+{
+	GTEST_POLICY_LOCK_ACQUIRE(mutex, 
+		pthread_mutex_lock, pthread_mutex_trylock, mutex);
+}
+
+extern "C" int pthread_mutex_trylock(pthread_mutex_t* mutex) noexcept
+{
+	GTEST_POLICY_LOCK_FORWARD(mutex, false, pthread_mutex_trylock, mutex);
+}
+
+extern "C" int pthread_mutex_timedlock(pthread_mutex_t* mutex,
+	const struct timespec* abstime) noexcept
+{
+	GTEST_POLICY_LOCK_FORWARD(mutex, true, 
+		pthread_mutex_timedlock, mutex, abstime);
+}
+
+extern "C" int pthread_spin_lock(pthread_spinlock_t* lock) noexcept
+{
+	GTEST_POLICY_LOCK_ACQUIRE(mutex, 
+		pthread_spin_lock, pthread_spin_trylock, lock);
+}
+
+extern "C" int pthread_rwlock_rdlock(pthread_rwlock_t* rwlock) noexcept
+{
+	GTEST_POLICY_LOCK_ACQUIRE(rwlock, 
+		pthread_rwlock_rdlock, pthread_rwlock_tryrdlock, rwlock);
+}
+
+extern "C" int pthread_rwlock_wrlock(pthread_rwlock_t* rwlock) noexcept
+{
+	GTEST_POLICY_LOCK_ACQUIRE(rwlock, 
+		pthread_rwlock_wrlock, pthread_rwlock_trywrlock, rwlock);
+}
+
+extern "C" int pthread_rwlock_tryrdlock(pthread_rwlock_t* rwlock) noexcept
+{
+	GTEST_POLICY_LOCK_FORWARD(rwlock, false, pthread_rwlock_tryrdlock, rwlock);
+}
+
+extern "C" int pthread_rwlock_trywrlock(pthread_rwlock_t* rwlock) noexcept
+{
+	GTEST_POLICY_LOCK_FORWARD(rwlock, false, pthread_rwlock_trywrlock, rwlock);
+}
+
+extern "C" int pthread_rwlock_timedrdlock(pthread_rwlock_t* rwlock,
+	const struct timespec* abstime) noexcept
+{
+	GTEST_POLICY_LOCK_FORWARD(rwlock, true, 
+		pthread_rwlock_timedrdlock, rwlock, abstime);
+}
+
+extern "C" int pthread_rwlock_timedwrlock(pthread_rwlock_t* rwlock,
+	const struct timespec* abstime) noexcept
+{
+	GTEST_POLICY_LOCK_FORWARD(rwlock, true, 
+		pthread_rwlock_timedwrlock, rwlock, abstime);
+}
+
+extern "C" int pthread_cond_wait(pthread_cond_t* cond, 
+	pthread_mutex_t* mutex)
+{
+	GTEST_POLICY_LOCK_FORWARD(condition_variable, true, 
+		pthread_cond_wait, cond, mutex);
+}
+
+extern "C" int pthread_cond_timedwait(pthread_cond_t* cond, 
+	pthread_mutex_t* mutex, const struct timespec* abstime)
+{
+	GTEST_POLICY_LOCK_FORWARD(condition_variable, true, 
+		pthread_cond_timedwait, cond, mutex, abstime);
+}
+
+#if __GLIBC_PREREQ(2, 30)
+extern "C" int pthread_mutex_clocklock(pthread_mutex_t* mutex,
+	clockid_t clockid, const struct timespec* abstime) noexcept
+{
+	GTEST_POLICY_LOCK_FORWARD(mutex, true, 
+		pthread_mutex_clocklock, mutex, clockid, abstime);
+}
+
+extern "C" int pthread_rwlock_clockrdlock(pthread_rwlock_t* rwlock,
+	clockid_t clockid, const struct timespec* abstime) noexcept
+{
+	GTEST_POLICY_LOCK_FORWARD(rwlock, true, 
+		pthread_rwlock_clockrdlock, rwlock, clockid, abstime);
+}
+
+extern "C" int pthread_rwlock_clockwrlock(pthread_rwlock_t* rwlock,
+	clockid_t clockid, const struct timespec* abstime) noexcept
+{
+	GTEST_POLICY_LOCK_FORWARD(rwlock, true, 
+		pthread_rwlock_clockwrlock, rwlock, clockid, abstime);
+}
+
+extern "C" int pthread_cond_clockwait(pthread_cond_t* cond, 
+	pthread_mutex_t* mutex, clockid_t clockid, const struct timespec* abstime)
+{
+	GTEST_POLICY_LOCK_FORWARD(condition_variable, true, 
+		pthread_cond_clockwait, cond, mutex, clockid, abstime);
+}
+#endif // __GLIBC_PREREQ(2, 30)
+
+#if defined(__x86_64__)
+#define GTEST_POLICY_LOCK_STR(x) GTEST_POLICY_LOCK_STR_(x)
+#define GTEST_POLICY_LOCK_STR_(x) #x
+
+// Next definition of syscall, i.e. libc, resolved on the first futex call
+extern "C"
+{
+	__attribute__((visibility("hidden"))) 
+	std::atomic<void*> gtest_policies_syscall_next(nullptr);
+}
+
+// Counts a futex operation and returns the next definition of syscall
+extern "C" __attribute__((visibility("hidden"))) 
+void* gtest_policies_syscall_futex(long number, long op) noexcept
+{
+	if (number == SYS_futex && gtest_policies::IsMonitoringLocks())
+	{
+		switch (static_cast<int>(op) & FUTEX_CMD_MASK)
+		{
+		case FUTEX_WAIT:
+		case FUTEX_WAIT_BITSET:
+		case FUTEX_WAIT_REQUEUE_PI:
+		case FUTEX_LOCK_PI:
+			gtest_policies::CountLock(gtest_policies::LockCall::futex, true);
+			break;
+		default:
+			break; // wake operations
+		}
+	}
+	return gtest_policies::detail::NextSymbol(
+		gtest_policies_syscall_next, "syscall");
+}
+
+// Futex waits are only visible when made via syscall(), e.g. by custom 
+// locks or std::atomic<T>::wait, since libc uses the system call directly.
+// syscall is variadic and callers pass as many arguments as the system call
+// takes, hence it is interposed by a trampoline tail-calling libc with all 
+// argument registers, %al and the stack unchanged. Only futex calls, and 
+// calls made before libc has been resolved, go through the hook above.
+asm(
+	".text\n"
+	".globl syscall\n"
+	".type syscall, @function\n"
+	"syscall:\n"
+	"	cmpq $" GTEST_POLICY_LOCK_STR(SYS_futex) ", %rdi\n"
+	"	je 1f\n"
+	"	movq gtest_policies_syscall_next(%rip), %r11\n"
+	"	testq %r11, %r11\n"
+	"	jz 1f\n"
+	"	jmp *%r11\n"
+	"1:\n"
+	"	pushq %rdi\n"
+	"	pushq %rsi\n"
+	"	pushq %rdx\n"
+	"	pushq %rcx\n"
+	"	pushq %r8\n"
+	"	pushq %r9\n"
+	"	pushq %rax\n"
+	"	movq %rdx, %rsi\n" // futex operation
+	"	call gtest_policies_syscall_futex\n"
+	"	movq %rax, %r11\n"
+	"	popq %rax\n"
+	"	popq %r9\n"
+	"	popq %r8\n"
+	"	popq %rcx\n"
+	"	popq %rdx\n"
+	"	popq %rsi\n"
+	"	popq %rdi\n"
+	"	jmp *%r11\n"
+	".size syscall, .-syscall\n"
+);
+
+#undef GTEST_POLICY_LOCK_STR_
+#undef GTEST_POLICY_LOCK_STR
+#endif // defined(__x86_64__)
+
+#undef GTEST_POLICY_LOCK_FORWARD
+#undef GTEST_POLICY_LOCK_ACQUIRE
+#undef GTEST_POLICY_LOCK_NEXT
+
+#endif // GTEST_POLICY_LOCK_HOOKS_AVAILABLE
+
+gtest_policies::listener::LockPolicyListener::LockPolicyListener()
+	: PolicyListener(lock_acquisition, std::make_unique<LockMonitor>())
+{ }
+
+const char* gtest_policies::listener::LockPolicyListener::MetricName(
+	std::size_t metric) const noexcept
+{
+	static const char* const names[] = { "lock_calls", "lock_blocking_calls" };
+	return metric < sizeof(names) / sizeof(names[0]) ? names[metric] : nullptr;
+}
+
+void gtest_policies::listener::LockPolicyListener::OnPolicyViolation()
+{
+	const auto& usage = Usage();
+	const auto& budget = Policy().Budget();
+	auto& ss = ViolationReport();
+	ss << "Policy violation: gtest_policy::lock_acquisition\n";
+	if (budget.metrics[0] == 0u)
+	{
+		ss << "Acquiring locks is not permitted by the test policy for this "
+			"test case. ";
+	}
+	else
+	{
+		ss << "Acquiring locks exceeded the budget permitted by the test "
+			"policy for this test case. ";
+	}
+	ss << "Calls: " << usage.metrics[0]
+		<< " (budget: " << detail::FormatLimit(budget.metrics[0]) << "), "
+		<< "blocking: " << usage.metrics[1]
+		<< " (budget: " << detail::FormatLimit(budget.metrics[1]) << "). "
+		<< "Calls per type:";
+	const char* separator = " ";
+	for (std::size_t i = 0; i < lock_call_count; ++i)
+	{
+		if (lock_test_calls[i] == 0u)
+			continue;
+		ss << separator << lock_call_names[i] << ": " << lock_test_calls[i];
+		separator = ", ";
+	}
+	ss << ". Re-run the test case in debug mode with debugger attached and a "
+		"breakpoint on the reported functions to find the origin. ";
+	GTEST_NONFATAL_FAILURE_(ss.c_str());
+}
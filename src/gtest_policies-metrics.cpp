@@ -0,0 +1,518 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+#include <gtest_policies/gtest_policies.h>
+
+#include "gtest_policies-internal.h"
+
+#include <cstdio>        // std::fprintf
+#include <cstdlib>       // std::strtod, std::strtoull
+#include <cstring>       // std::strcmp, std::strncmp
+#include <fstream>       // std::ifstream, std::ofstream
+#include <unordered_map> // std::unordered_map
+#include <unordered_set> // std::unordered_set
+#include <vector>        // std::vector
+
+namespace
+{
+	enum class MetricsFormat
+	{
+		none,
+		json,
+		csv
+	};
+
+	// Metrics of a single test, values are indexed by column
+	struct MetricsRecord
+	{
+		const ::testing::TestInfo* test_info;
+		std::string suite;
+		std::string test;
+		std::int64_t elapsed_ms;
+		std::vector<std::uint64_t> values;
+		std::vector<bool> present;
+	};
+
+	bool metrics_configured = false;
+	bool metrics_written = false;
+	MetricsFormat metrics_format = MetricsFormat::none;
+	std::string metrics_path;
+	std::vector<std::string> metrics_columns;
+	std::vector<MetricsRecord> metrics_records;
+
+	const char elapsed_column[] = "elapsed_ms";
+	const double default_tolerance = 0.1;
+	const std::size_t no_row = static_cast<std::size_t>(-1);
+	const std::size_t no_column = static_cast<std::size_t>(-1);
+
+	// Baseline loaded once when the test program starts. Tests are looked up
+	// by "suite.test" in a hash index built while loading, hence the cost of
+	// comparing a test does not depend on the size of the baseline. Values 
+	// are stored row by row, metrics missing for a test are unlimited.
+	struct Baseline
+	{
+		Baseline();
+
+		std::string path;
+		double tolerance;
+		bool rewrite;
+		bool loaded;
+
+		std::vector<std::string> columns;
+		std::vector<std::string> suites;
+		std::vector<std::string> tests;
+		std::vector<std::uint64_t> values;
+		std::unordered_map<std::string, std::size_t> index;
+
+		// Row of the most recently looked up test
+		const ::testing::TestInfo* test_info;
+		std::size_t row;
+	};
+
+	bool ParseTolerance(const char* text, double& tolerance)
+	{
+		char* end = nullptr;
+		const double value = std::strtod(text, &end);
+		if (end == text || *end != '\0' || !(value >= 0.0))
+		{
+			std::fprintf(stderr, "WARNING: gtest_policies ignores baseline "
+				"tolerance \"%s\", expected a non-negative number.\n", text);
+			return false;
+		}
+		tolerance = value;
+		return true;
+	}
+
+	Baseline::Baseline()
+		: path(gtest_policies::detail::GetEnv("GTEST_POLICIES_BASELINE")),
+		tolerance(default_tolerance),
+		rewrite(false),
+		loaded(false),
+		test_info(nullptr),
+		row(no_row)
+	{
+		using gtest_policies::detail::GetEnv;
+		const auto rewrite_env = GetEnv("GTEST_POLICIES_REWRITE_BASELINE");
+		rewrite = !rewrite_env.empty() && rewrite_env != "0";
+		const auto tolerance_env = GetEnv("GTEST_POLICIES_BASELINE_TOLERANCE");
+		if (!tolerance_env.empty())
+			ParseTolerance(tolerance_env.c_str(), tolerance);
+	}
+
+	Baseline& GetBaseline()
+	{
+		static Baseline baseline;
+		return baseline;
+	}
+
+	void ClearBaseline(Baseline& baseline)
+	{
+		baseline.loaded = false;
+		baseline.columns.clear();
+		baseline.suites.clear();
+		baseline.tests.clear();
+		baseline.values.clear();
+		baseline.index.clear();
+		baseline.test_info = nullptr;
+		baseline.row = no_row;
+	}
+
+	void ClearMetrics()
+	{
+		metrics_written = false;
+		metrics_columns.clear();
+		metrics_records.clear();
+	}
+
+	void ConfigureMetrics(const std::string& output)
+	{
+		metrics_configured = true;
+		metrics_format = MetricsFormat::none;
+		metrics_path.clear();
+		ClearMetrics();
+
+		const auto separator = output.find(':');
+		if (output.empty() || separator == std::string::npos)
+		{
+			if (!output.empty())
+			{
+				std::fprintf(stderr, "WARNING: gtest_policies ignores metrics "
+					"output \"%s\", expected json:<path> or csv:<path>.\n",
+					output.c_str());
+			}
+			return;
+		}
+
+		const auto format = output.substr(0u, separator);
+		if (format == "json")
+			metrics_format = MetricsFormat::json;
+		else if (format == "csv")
+			metrics_format = MetricsFormat::csv;
+		else
+		{
+			std::fprintf(stderr, "WARNING: gtest_policies ignores unknown "
+				"metrics format \"%s\".\n", format.c_str());
+			return;
+		}
+		metrics_path = output.substr(separator + 1u);
+	}
+
+	bool IsMetricsExportEnabled()
+	{
+		if (!metrics_configured)
+			ConfigureMetrics(gtest_policies::detail::GetEnv("GTEST_POLICIES_METRICS"));
+		return metrics_format != MetricsFormat::none;
+	}
+
+	std::size_t MetricColumn(const char* name)
+	{
+		for (std::size_t i = 0; i < metrics_columns.size(); ++i)
+		{
+			if (metrics_columns[i] == name)
+				return i;
+		}
+		metrics_columns.emplace_back(name);
+		return metrics_columns.size() - 1u;
+	}
+
+	void SetValue(MetricsRecord& record, std::size_t column, 
+		std::uint64_t value)
+	{
+		if (record.values.size() <= column)
+		{
+			record.values.resize(column + 1u, 0u);
+			record.present.resize(column + 1u, false);
+		}
+		record.values[column] = value;
+		record.present[column] = true;
+	}
+
+	void AppendCsvField(std::string& csv, const std::string& text)
+	{
+		if (text.find_first_of(",\"\r\n") == std::string::npos)
+		{
+			csv += text;
+			return;
+		}
+		csv += '"';
+		for (const auto c : text)
+		{
+			if (c == '"')
+				csv += '"';
+			csv += c;
+		}
+		csv += '"';
+	}
+
+	// Splits a line written by FormatCsv() into fields
+	void SplitCsvLine(const std::string& line, std::vector<std::string>& fields)
+	{
+		fields.clear();
+		std::string field;
+		bool quoted = false;
+		for (std::size_t i = 0; i < line.size(); ++i)
+		{
+			const char c = line[i];
+			if (quoted && c == '"' && i + 1u < line.size() && line[i + 1u] == '"')
+			{
+				field += c;
+				++i;
+			}
+			else if (c == '"')
+				quoted = !quoted;
+			else if (c == ',' && !quoted)
+			{
+				fields.push_back(field);
+				field.clear();
+			}
+			else if (c != '\r')
+				field += c;
+		}
+		fields.push_back(field);
+	}
+
+	std::string FormatJson()
+	{
+		std::string json = "{\n  \"tests\": [";
+		for (std::size_t i = 0; i < metrics_records.size(); ++i)
+		{
+			const auto& record = metrics_records[i];
+			json += i == 0u ? "\n    {\"suite\":" : ",\n    {\"suite\":";
+			gtest_policies::detail::AppendJsonString(json, record.suite.c_str());
+			json += ",\"test\":";
+			gtest_policies::detail::AppendJsonString(json, record.test.c_str());
+			json += ",\"elapsed_ms\":" + std::to_string(record.elapsed_ms);
+			for (std::size_t column = 0; column < record.values.size(); ++column)
+			{
+				if (!record.present[column])
+					continue;
+				json += ',';
+				gtest_policies::detail::AppendJsonString(json, 
+					metrics_columns[column].c_str());
+				json += ':' + std::to_string(record.values[column]);
+			}
+			json += '}';
+		}
+		json += "\n  ]\n}\n";
+		return json;
+	}
+
+	std::string FormatCsv(const std::vector<MetricsRecord>& records)
+	{
+		// Tests not measuring a metric leave its field empty
+		std::string csv = "suite,test,elapsed_ms";
+		for (const auto& column : metrics_columns)
+			csv += ',' + column;
+		csv += '\n';
+		for (const auto& record : records)
+		{
+			AppendCsvField(csv, record.suite);
+			csv += ',';
+			AppendCsvField(csv, record.test);
+			csv += ',' + std::to_string(record.elapsed_ms);
+			for (std::size_t column = 0; column < metrics_columns.size(); ++column)
+			{
+				csv += ',';
+				if (column < record.values.size() && record.present[column])
+					csv += std::to_string(record.values[column]);
+			}
+			csv += '\n';
+		}
+		return csv;
+	}
+
+	void WriteFile(const std::string& path, const std::string& content, 
+		const char* what)
+	{
+		std::ofstream file(path);
+		file << content;
+		if (!file)
+		{
+			std::fprintf(stderr, "WARNING: gtest_policies failed to write "
+				"%s to \"%s\".\n", what, path.c_str());
+		}
+	}
+
+	// Rewrites the baseline with the recorded metrics, keeping the baseline
+	// of tests not recorded, e.g. tests excluded by --gtest_filter.
+	void RewriteBaseline(const Baseline& baseline)
+	{
+		std::vector<MetricsRecord> records(metrics_records);
+		std::unordered_set<std::string> recorded;
+		for (const auto& record : records)
+			recorded.insert(record.suite + "." + record.test);
+
+		// Metrics column of each baseline column, elapsed time is not a metric
+		std::vector<std::size_t> columns;
+		for (const auto& column : baseline.columns)
+		{
+			columns.push_back(column == elapsed_column ? 
+				no_column : MetricColumn(column.c_str()));
+		}
+
+		for (std::size_t row = 0; row < baseline.suites.size(); ++row)
+		{
+			if (recorded.count(baseline.suites[row] + "." + baseline.tests[row]))
+				continue;
+
+			MetricsRecord record;
+			record.test_info = nullptr;
+			record.suite = baseline.suites[row];
+			record.test = baseline.tests[row];
+			record.elapsed_ms = 0;
+			for (std::size_t i = 0; i < columns.size(); ++i)
+			{
+				const auto value = baseline.values[row * columns.size() + i];
+				if (value == gtest_policies::unlimited)
+					continue;
+				if (columns[i] == no_column)
+					record.elapsed_ms = static_cast<std::int64_t>(value);
+				else
+					SetValue(record, columns[i], value);
+			}
+			records.push_back(std::move(record));
+		}
+		WriteFile(baseline.path, FormatCsv(records), "baseline");
+	}
+}
+
+void gtest_policies::SetMetricsOutput(const char* output)
+{
+	ConfigureMetrics(output != nullptr ? output : "");
+}
+
+void gtest_policies::SetBaseline(const char* path, double tolerance, 
+	bool rewrite)
+{
+	auto& baseline = GetBaseline();
+	ClearBaseline(baseline);
+	ClearMetrics();
+	baseline.path = path != nullptr ? path : "";
+	baseline.tolerance = tolerance;
+	baseline.rewrite = rewrite;
+}
+
+void gtest_policies::ParseFlags(int* argc, char** argv)
+{
+	static const char metrics_flag[] = "--gtest_policies_metrics=";
+	static const char baseline_flag[] = "--gtest_policies_baseline=";
+	static const char tolerance_flag[] = "--gtest_policies_baseline_tolerance=";
+	static const char rewrite_flag[] = "--gtest_policies_rewrite_baseline";
+
+	auto& baseline = GetBaseline();
+	int j = 1;
+	for (int i = 1; i < *argc; ++i)
+	{
+		const char* arg = argv[i];
+		if (std::strncmp(arg, metrics_flag, sizeof(metrics_flag) - 1u) == 0)
+			SetMetricsOutput(arg + sizeof(metrics_flag) - 1u);
+		else if (std::strncmp(arg, baseline_flag, sizeof(baseline_flag) - 1u) == 0)
+			baseline.path = arg + sizeof(baseline_flag) - 1u;
+		else if (std::strncmp(arg, tolerance_flag, sizeof(tolerance_flag) - 1u) == 0)
+			ParseTolerance(arg + sizeof(tolerance_flag) - 1u, baseline.tolerance);
+		else if (std::strcmp(arg, rewrite_flag) == 0)
+			baseline.rewrite = true;
+		else
+			argv[j++] = argv[i];
+	}
+	if (j < *argc)
+	{
+		argv[j] = nullptr; // argv[argc] is a null pointer
+		*argc = j;
+	}
+}
+
+bool gtest_policies::detail::IsMetricsEnabled()
+{
+	return IsMetricsExportEnabled() || !GetBaseline().path.empty();
+}
+
+void gtest_policies::detail::RecordMetric(const ::testing::TestInfo& test_info,
+	const char* name, std::uint64_t value)
+{
+	const auto column = MetricColumn(name);
+
+	// Listeners of the same test end one after another, a metric already 
+	// present means the test is run again, e.g. due to --gtest_repeat.
+	if (metrics_records.empty() || 
+		metrics_records.back().test_info != &test_info ||
+		(column < metrics_records.back().present.size() && 
+			metrics_records.back().present[column]))
+	{
+		MetricsRecord record;
+		record.test_info = &test_info;
+		record.suite = test_info.test_suite_name();
+		record.test = test_info.name();
+		record.elapsed_ms = static_cast<std::int64_t>(
+			test_info.result()->elapsed_time());
+		metrics_records.push_back(std::move(record));
+	}
+	SetValue(metrics_records.back(), column, value);
+}
+
+void gtest_policies::detail::LoadBaseline()
+{
+	auto& baseline = GetBaseline();
+	if (baseline.loaded || baseline.path.empty())
+		return;
+	baseline.loaded = true;
+
+	std::ifstream file(baseline.path);
+	if (!file)
+	{
+		if (!baseline.rewrite)
+		{
+			std::fprintf(stderr, "WARNING: gtest_policies baseline \"%s\" "
+				"not found, tests are not compared.\n", baseline.path.c_str());
+		}
+		return;
+	}
+
+	std::string line;
+	std::vector<std::string> fields;
+	if (std::getline(file, line))
+		SplitCsvLine(line, fields);
+	if (fields.size() < 2u || fields[0] != "suite" || fields[1] != "test")
+	{
+		std::fprintf(stderr, "WARNING: gtest_policies baseline \"%s\" is not "
+			"a CSV metrics file, tests are not compared.\n", 
+			baseline.path.c_str());
+		return;
+	}
+	baseline.columns.assign(fields.begin() + 2, fields.end());
+
+	const auto n = baseline.columns.size();
+	while (std::getline(file, line))
+	{
+		SplitCsvLine(line, fields);
+		if (fields.size() < 2u)
+			continue;
+
+		const auto row = baseline.suites.size();
+		baseline.suites.push_back(fields[0]);
+		baseline.tests.push_back(fields[1]);
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			const bool present = i + 2u < fields.size() && !fields[i + 2u].empty();
+			baseline.values.push_back(present ? 
+				std::strtoull(fields[i + 2u].c_str(), nullptr, 10) : unlimited);
+		}
+		baseline.index.emplace(fields[0] + "." + fields[1], row);
+	}
+}
+
+bool gtest_policies::detail::ExceedsBaseline(
+	const ::testing::TestInfo& test_info, const char* name, 
+	std::uint64_t value, std::uint64_t& baseline_value)
+{
+	auto& baseline = GetBaseline();
+	if (baseline.rewrite || baseline.index.empty())
+		return false;
+
+	if (baseline.test_info != &test_info)
+	{
+		const auto it = baseline.index.find(
+			std::string(test_info.test_suite_name()) + "." + test_info.name());
+		baseline.test_info = &test_info;
+		baseline.row = it != baseline.index.end() ? it->second : no_row;
+	}
+	if (baseline.row == no_row)
+		return false;
+
+	const auto n = baseline.columns.size();
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		if (baseline.columns[i] != name)
+			continue;
+		baseline_value = baseline.values[baseline.row * n + i];
+		return baseline_value != unlimited && static_cast<double>(value) > 
+			static_cast<double>(baseline_value) * (1.0 + baseline.tolerance);
+	}
+	return false;
+}
+
+double gtest_policies::detail::BaselineTolerance()
+{
+	return GetBaseline().tolerance;
+}
+
+void gtest_policies::detail::WriteMetrics()
+{
+	if (metrics_written)
+		return;
+	metrics_written = true;
+
+	if (IsMetricsExportEnabled())
+	{
+		WriteFile(metrics_path, metrics_format == MetricsFormat::json ? 
+			FormatJson() : FormatCsv(metrics_records), "metrics");
+	}
+
+	const auto& baseline = GetBaseline();
+	if (baseline.rewrite && !baseline.path.empty())
+	{
+		LoadBaseline(); // unless loaded when the test program started
+		RewriteBaseline(baseline);
+	}
+}
@@ -4,50 +4,124 @@
 
 #include <gtest_policies/gtest_policies.h>
 
+#include "gtest_policies-internal.h"
+
 #include <iostream>
+#include <atomic>
+#include <cassert>
 #include <cctype>
+#include <climits>
 #include <cstdio>
 
+#if defined(__unix__) || defined(__APPLE__)
+  #define GTEST_POLICY_FD_MONITOR_AVAILABLE
+  #include <cerrno>   // errno
+  #include <system_error> // std::system_error
+  #include <thread>   // std::thread
+  #include <fcntl.h>  // fcntl, splice
+  #include <poll.h>   // poll
+  #include <unistd.h> // pipe, dup, dup2, read, write, close
+#endif
+
 namespace gtest_policies
 {
 	class CountingStreamBufferFilter : public std::streambuf
 	{
 	public:
 		CountingStreamBufferFilter(std::streambuf* dst)
-			: cnt_(0u), dst_(dst)
+			: writes_(0u), cnt_(0u), dst_(dst)
 		{ 
 			assert(dst);
+			setp(buffer_, buffer_ + buffer_size);
+		}
+
+		size_t writes()
+		{
+			return writes_.load(std::memory_order_relaxed);
 		}
 
 		size_t count()
 		{
-			return cnt_;
+			return cnt_.load(std::memory_order_relaxed);
 		}
 
 		void reset()
 		{
-			cnt_ = 0;
+			writes_.store(0u, std::memory_order_relaxed);
+			cnt_.store(0u, std::memory_order_relaxed);
 		}
 
 	protected:
-		virtual int_type overflow(int_type c) 
+		// Output is collected in the put area and forwarded to the destination
+		// as a single write when the put area is full or the stream is 
+		// flushed, hence a write is a chunk forwarded to the destination 
+		// regardless of how the output was formatted. Like any buffered 
+		// stream, output is delayed until flushed, i.e. interleaving with C 
+		// stdio output is only preserved across flushes, and concurrent 
+		// writes must be synchronized by the caller. Sequences not fitting 
+		// the put area are forwarded directly as a single write.
+		std::streamsize xsputn(const char_type* s, std::streamsize n) override
 		{
-			++cnt_;
-
-			int_type result(EOF);
-			if (c == EOF)
-				result = sync();
-			else if (dst_)
+			if (n > epptr() - pptr())
 			{
-				assert(c >= 0 && c <= UCHAR_MAX);
-				result = dst_->sputc(static_cast<char>(c));
+				if (!Forward())
+					return 0;
+				if (n >= buffer_size)
+				{
+					Count(n);
+					return dst_->sputn(s, n);
+				}
 			}
-			return result;
+			traits_type::copy(pptr(), s, static_cast<size_t>(n));
+			pbump(static_cast<int>(n));
+			return n;
+		}
+
+		int sync() override
+		{
+			if (!Forward())
+				return -1;
+			return dst_->pubsync();
+		}
+
+		int_type overflow(int_type c) override
+		{
+			if (!Forward())
+				return traits_type::eof();
+			if (traits_type::eq_int_type(c, traits_type::eof()))
+				return traits_type::not_eof(c);
+
+			assert(c >= 0 && c <= UCHAR_MAX);
+			*pptr() = traits_type::to_char_type(c);
+			pbump(1);
+			return c;
 		}
 
 	private:
-		size_t cnt_;
+		static const std::streamsize buffer_size = 1024;
+
+		void Count(std::streamsize n) noexcept
+		{
+			writes_.fetch_add(1u, std::memory_order_relaxed);
+			cnt_.fetch_add(static_cast<size_t>(n), std::memory_order_relaxed);
+		}
+
+		// Forwards the put area to the destination as a single write.
+		bool Forward()
+		{
+			const auto n = pptr() - pbase();
+			if (n == 0)
+				return true;
+			Count(n);
+			setp(buffer_, buffer_ + buffer_size);
+			return dst_->sputn(buffer_, n) == n;
+		}
+
+		// Counters may be read by another thread than the writing thread
+		std::atomic<size_t> writes_;
+		std::atomic<size_t> cnt_;
 		std::streambuf* dst_;
+		char buffer_[buffer_size];
 	};
 
 	template<class Char, class Traits = std::char_traits<Char>>
@@ -55,56 +129,360 @@ namespace gtest_policies
 	{
 	public:
 		OutputStreamMonitor(std::basic_ostream<Char, Traits>& ostream) 
-			: stream_(ostream), original_(ostream.rdbuf()), filter_(ostream.rdbuf())
+			: stream_(ostream), original_(ostream.rdbuf()), filter_(ostream.rdbuf()),
+			writes_(0u), count_(0u)
 		{
 			ostream.rdbuf(&filter_);
 		}
 
 		~OutputStreamMonitor()
 		{
+			filter_.pubsync();
 			stream_.rdbuf(original_);
 		}
 
+		// Buffered output is flushed when monitoring starts and stops, so 
+		// that it is accounted to the period in which it was written.
 		void Start() override
 		{
+			filter_.pubsync();
 			filter_.reset();
 		}
 
 		bool Stop() override
 		{
-			return filter_.count() > 0u;
+			filter_.pubsync();
+			writes_ = filter_.writes();
+			count_ = filter_.count();
+			return count_ > 0u;
+		}
+
+		detail::PolicyUsage Usage() const override
+		{
+			detail::PolicyUsage usage = { { writes_, count_ } };
+			return usage;
 		}
 
 		std::basic_ostream<Char, Traits>& stream_;
 		std::streambuf* original_;
 		CountingStreamBufferFilter filter_;
+		size_t writes_;
+		size_t count_;
+	};
+
+#ifdef GTEST_POLICY_FD_MONITOR_AVAILABLE
+	// Monitors a file descriptor, e.g. standard output, by redirecting it 
+	// into a pipe while started. A dedicated thread drains the pipe, counts
+	// the bytes and forwards them to the original file descriptor. This 
+	// detects output written by any means, e.g. printf, puts, fwrite, write 
+	// or C++ streams. The thread is created when monitoring first starts, 
+	// within the internal scope of this library, and is reused so that later
+	// starts and stops neither create threads nor allocate memory.
+	class FileDescriptorMonitor : public gtest_policies::detail::PolicyMonitor
+	{
+	public:
+		FileDescriptorMonitor(int fd, FILE* file, std::ostream& stream)
+			: fd_(fd), file_(file), stream_(stream), original_(-1),
+			data_{ -1, -1 }, control_{ -1, -1 }, ack_{ -1, -1 },
+			writes_(0u), bytes_(0u), start_writes_(0u), start_bytes_(0u),
+			stop_writes_(0u), stop_bytes_(0u), splice_(true), valid_(false)
+		{
+			valid_ = CreatePipe(data_) && CreatePipe(control_) && 
+				CreatePipe(ack_) &&
+				fcntl(data_[0], F_SETFL, O_NONBLOCK) == 0;
+		}
+
+		~FileDescriptorMonitor()
+		{
+			if (original_.load() >= 0)
+				Stop();
+			if (thread_.joinable())
+			{
+				Request('q');
+				thread_.join();
+			}
+			for (auto fd : { data_[0], data_[1], control_[0], control_[1],
+				ack_[0], ack_[1] })
+			{
+				if (fd >= 0)
+					close(fd);
+			}
+		}
+
+		void Start() override
+		{
+			if (!valid_ || original_.load() >= 0)
+				return;
+			detail::InternalScope scope;
+
+			if (!thread_.joinable())
+			{
+				try
+				{
+					thread_ = std::thread([this]() { Drain(); });
+				}
+				catch (const std::system_error&)
+				{
+					valid_ = false; // not monitored
+					return;
+				}
+			}
+
+			// Emit any pending output before redirecting
+			stream_.flush();
+			fflush(file_);
+
+			start_writes_ = writes_.load();
+			start_bytes_ = bytes_.load();
+			original_.store(dup(fd_));
+			if (original_.load() >= 0)
+				dup2(data_[1], fd_);
+		}
+
+		bool Stop() override
+		{
+			if (original_.load() < 0)
+				return false;
+			detail::InternalScope scope;
+
+			// Make buffered output reach the pipe, then restore the original
+			// file descriptor and wait until the pipe has been drained.
+			stream_.flush();
+			fflush(file_);
+			dup2(original_.load(), fd_);
+			Request('d');
+			char ack;
+			while (read(ack_[0], &ack, 1) < 0 && errno == EINTR) { }
+			close(original_.exchange(-1));
+
+			stop_writes_ = writes_.load();
+			stop_bytes_ = bytes_.load();
+			return stop_bytes_ != start_bytes_;
+		}
+
+		detail::PolicyUsage Usage() const override
+		{
+			detail::PolicyUsage usage = { { 
+				stop_writes_ - start_writes_, stop_bytes_ - start_bytes_ } };
+			return usage;
+		}
+
+	private:
+		static bool CreatePipe(int (&fds)[2])
+		{
+			if (pipe(fds) != 0)
+				return false;
+			fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+			fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+			return true;
+		}
+
+		void Request(char request)
+		{
+			while (write(control_[1], &request, 1) < 0 && errno == EINTR) { }
+		}
+
+		void Drain()
+		{
+			detail::InternalScope scope; // for the lifetime of the thread
+			pollfd fds[2] = { { data_[0], POLLIN, 0 }, { control_[0], POLLIN, 0 } };
+			for (;;)
+			{
+				if (poll(fds, 2, -1) < 0)
+				{
+					if (errno == EINTR)
+						continue;
+					return;
+				}
+
+				if (fds[0].revents & POLLIN)
+					Forward();
+
+				if (fds[1].revents & POLLIN)
+				{
+					char request = 0;
+					if (read(control_[0], &request, 1) != 1)
+						continue;
+					if (request == 'q')
+						return;
+
+					while (Forward()) { } // drain until empty
+					const char ack = 'a';
+					while (write(ack_[1], &ack, 1) < 0 && errno == EINTR) { }
+				}
+			}
+		}
+
+		static bool Wait(int fd, short events, int timeout)
+		{
+			pollfd pfd = { fd, events, 0 };
+			int result;
+			while ((result = poll(&pfd, 1, timeout)) < 0 && errno == EINTR) { }
+			return result > 0;
+		}
+
+		// Forwards one chunk of pending data, returns false if the pipe is 
+		// empty. Waits for the target to become writable if it is full, e.g.
+		// a pipe to a slow reader, rather than leaving data in the pipe.
+		bool Forward()
+		{
+			const auto original = original_.load();
+			const auto target = original >= 0 ? original : fd_;
+			for (;;)
+			{
+				ssize_t n = -1;
+#ifdef __linux__
+				// Move data from the pipe without copying it into user space.
+				// Not all targets support splice, e.g. terminals.
+				if (splice_)
+				{
+					n = splice(data_[0], nullptr, target, nullptr, 
+						65536u, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+					if (n < 0 && errno == EINVAL)
+					{
+						splice_ = false;
+						continue; // retry without splice
+					}
+				}
+#endif // __linux__
+				if (!splice_)
+					n = Copy(target);
+
+				if (n > 0)
+				{
+					writes_.fetch_add(1u, std::memory_order_relaxed);
+					bytes_.fetch_add(static_cast<size_t>(n), 
+						std::memory_order_relaxed);
+					return true;
+				}
+				if (n == 0 || (errno != EINTR && errno != EAGAIN))
+					return false;
+				if (errno == EAGAIN)
+				{
+					// Either the pipe is empty or the target is full
+					if (!Wait(data_[0], POLLIN, 0))
+						return false;
+					Wait(target, POLLOUT, -1);
+				}
+			}
+		}
+
+		// Copies one chunk of pending data via user space, returns the 
+		// number of bytes read from the pipe.
+		ssize_t Copy(int target)
+		{
+			char buffer[65536];
+			const auto n = read(data_[0], buffer, sizeof(buffer));
+			for (ssize_t written = 0; written < n; )
+			{
+				const auto result = write(target, buffer + written,
+					static_cast<size_t>(n - written));
+				if (result > 0)
+					written += result;
+				else if (result < 0 && errno == EAGAIN)
+					Wait(target, POLLOUT, -1);
+				else if (result < 0 && errno != EINTR)
+					break; // output lost, but still counted
+			}
+			return n;
+		}
+
+		int fd_;
+		FILE* file_;
+		std::ostream& stream_;
+		std::atomic<int> original_;
+		int data_[2];
+		int control_[2];
+		int ack_[2];
+		std::atomic<size_t> writes_;
+		std::atomic<size_t> bytes_;
+		size_t start_writes_;
+		size_t start_bytes_;
+		size_t stop_writes_;
+		size_t stop_bytes_;
+		bool splice_;
+		bool valid_;
+		std::thread thread_;
 	};
+#endif // GTEST_POLICY_FD_MONITOR_AVAILABLE
+
+	static std::unique_ptr<detail::PolicyMonitor> MakeOutputMonitor(
+		listener::OutputMonitoring monitoring, std::ostream& stream,
+		int fd, FILE* file)
+	{
+#ifdef GTEST_POLICY_FD_MONITOR_AVAILABLE
+		if (monitoring == listener::OutputMonitoring::file_descriptor)
+			return std::make_unique<FileDescriptorMonitor>(fd, file, stream);
+#else
+		(void)monitoring;
+		(void)fd;
+		(void)file;
+#endif // GTEST_POLICY_FD_MONITOR_AVAILABLE
+		return std::make_unique<OutputStreamMonitor<char>>(stream);
+	}
+
+	static void FormatStreamPolicyViolation(detail::ReportBuffer& ss,
+		const char* policy, const char* stream, 
+		const detail::PolicyUsage& usage, const detail::PolicyUsage& budget)
+	{
+		ss << "Policy violation: " << policy << "\n";
+		if (budget.metrics[0] == 0u)
+		{
+			ss << "Writing to " << stream << " is not permitted by the test "
+				"policy for this test case. ";
+		}
+		else
+		{
+			ss << "Writing to " << stream << " exceeded the budget permitted "
+				"by the test policy for this test case. ";
+		}
+		ss << "Writes: " << usage.metrics[0]
+			<< " (budget: " << detail::FormatLimit(budget.metrics[0]) << "), "
+			<< "bytes: " << usage.metrics[1]
+			<< " (budget: " << detail::FormatLimit(budget.metrics[1]) << "). "
+			"Re-run the test case in debug mode with debugger attached to "
+			"break at the statement causing this policy violation. ";
+	}
 }
 
-gtest_policies::listener::StdOutPolicyListener::StdOutPolicyListener()
-	: PolicyListener(standard_output, std::make_unique<OutputStreamMonitor<char>>(std::cout))
+gtest_policies::listener::StdOutPolicyListener::StdOutPolicyListener(
+	OutputMonitoring monitoring)
+	: PolicyListener(standard_output, 
+		MakeOutputMonitor(monitoring, std::cout, 1, stdout))
 { }
 
+const char* gtest_policies::listener::StdOutPolicyListener::MetricName(
+	std::size_t metric) const noexcept
+{
+	static const char* const names[] = { "stdout_writes", "stdout_bytes" };
+	return metric < sizeof(names) / sizeof(names[0]) ? names[metric] : nullptr;
+}
+
 void gtest_policies::listener::StdOutPolicyListener::OnPolicyViolation()
 {
-	GTEST_NONFATAL_FAILURE_(\
-		"Policy violation: gtest_policy::cxx_std_out\n" \
-		"Writing to standard output is not permitted by the test policy " \
-		"for this test case. " \
-		"Re-run the test case in debug mode with debugger attached to " \
-		"break at the statement causing this policy violation. ");
+	auto& report = ViolationReport();
+	FormatStreamPolicyViolation(report, "gtest_policy::cxx_std_out", 
+		"standard output", Usage(), Policy().Budget());
+	GTEST_NONFATAL_FAILURE_(report.c_str());
 }
 
-gtest_policies::listener::StdErrPolicyListener::StdErrPolicyListener()
-	: PolicyListener(standard_error, std::make_unique<OutputStreamMonitor<char>>(std::cerr))
+gtest_policies::listener::StdErrPolicyListener::StdErrPolicyListener(
+	OutputMonitoring monitoring)
+	: PolicyListener(standard_error, 
+		MakeOutputMonitor(monitoring, std::cerr, 2, stderr))
 { }
 
+const char* gtest_policies::listener::StdErrPolicyListener::MetricName(
+	std::size_t metric) const noexcept
+{
+	static const char* const names[] = { "stderr_writes", "stderr_bytes" };
+	return metric < sizeof(names) / sizeof(names[0]) ? names[metric] : nullptr;
+}
+
 void gtest_policies::listener::StdErrPolicyListener::OnPolicyViolation()
 {
-	GTEST_NONFATAL_FAILURE_(\
-		"Policy violation: gtest_policy::cxx_std_err\n" \
-		"Writing to standard error is not permitted by the test policy " \
-		"for this test case. " \
-		"Re-run the test case in debug mode with debugger attached to " \
-		"break at the statement causing this policy violation. ");
+	auto& report = ViolationReport();
+	FormatStreamPolicyViolation(report, "gtest_policy::cxx_std_err", 
+		"standard error", Usage(), Policy().Budget());
+	GTEST_NONFATAL_FAILURE_(report.c_str());
 }
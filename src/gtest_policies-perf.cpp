@@ -0,0 +1,276 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+#include <gtest_policies/gtest_policies.h>
+
+#include "gtest_policies-internal.h"
+
+#include <cstdio> // std::fprintf
+
+#if defined(__linux__) && !defined(GTEST_POLICY_DISABLE_PERF_COUNTERS)
+  #define GTEST_POLICY_PERF_COUNTERS_AVAILABLE
+  #include <cerrno>              // errno
+  #include <cstring>             // std::memset, std::strerror
+  #include <linux/perf_event.h>  // perf_event_attr
+  #include <sys/ioctl.h>         // ioctl
+  #include <sys/syscall.h>       // SYS_perf_event_open
+  #include <unistd.h>            // syscall, read
+#else
+  #ifndef GTEST_POLICY_SILENCE_WARNINGS
+    #pragma message ( \
+      "WARNING: gtest_policy::hardware_counters policy." \
+      "Hardware performance counters not supported on this compiler/platform.")
+  #endif // GTEST_POLICY_SILENCE_WARNINGS
+#endif
+
+namespace gtest_policies
+{
+	// Property keys and descriptions of metric 0-3
+	static const char* const perf_counter_keys[] = {
+		"instructions", "cycles", "branch_misses", "llc_misses"
+	};
+	static const char* const perf_counter_names[] = {
+		"Instructions", "cycles", "branch misses", "LLC misses"
+	};
+
+	// Counters count the thread that opened them, hence they are reopened 
+	// when the policy is applied on another thread, and kept open until the
+	// process exits otherwise. A counter not supported by the hardware, 
+	// hypervisor or kernel configuration has a negative fd.
+	static int perf_fds[detail::PolicyUsage::max_metrics] = { -1, -1, -1, -1 };
+	static int perf_leader = -1;
+	static int perf_error = 0;
+	static bool perf_opened = false;
+#ifdef GTEST_POLICY_PERF_COUNTERS_AVAILABLE
+	static long perf_thread = 0;
+#endif // GTEST_POLICY_PERF_COUNTERS_AVAILABLE
+
+	// Whether each counter was scheduled on the PMU while enabled during the 
+	// last measurement, i.e. whether its value is known
+	static bool perf_measured[detail::PolicyUsage::max_metrics];
+	
+	// Whether the policy was denied during the current test
+	static bool perf_requested = false;
+
+#ifdef GTEST_POLICY_PERF_COUNTERS_AVAILABLE
+	static void ClosePerfCounters() noexcept
+	{
+		for (auto& fd : perf_fds)
+		{
+			if (fd >= 0)
+				close(fd);
+			fd = -1;
+		}
+		perf_leader = -1;
+	}
+#endif // GTEST_POLICY_PERF_COUNTERS_AVAILABLE
+
+	// Opens counters for the calling thread, unless already open for it
+	static bool OpenPerfCounters() noexcept
+	{
+#ifdef GTEST_POLICY_PERF_COUNTERS_AVAILABLE
+		const auto thread = syscall(SYS_gettid);
+		if (perf_opened && (perf_leader < 0 || perf_thread == thread))
+			return perf_leader >= 0; // failure is a property of the system
+		ClosePerfCounters();
+		perf_opened = true;
+		perf_thread = thread;
+
+		static const std::uint64_t configs[detail::PolicyUsage::max_metrics] = {
+			PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES,
+			PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES
+		};
+		for (std::size_t i = 0; i < detail::PolicyUsage::max_metrics; ++i)
+		{
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = configs[i];
+			attr.disabled = perf_leader < 0 ? 1 : 0; // enabled via leader
+			attr.exclude_kernel = 1; // permitted with perf_event_paranoid 2
+			attr.exclude_hv = 1;
+
+			// Counters are multiplexed if the group does not fit on the PMU,
+			// values are then scaled by the fraction of time measured
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | 
+				PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+			// Counts the calling thread on any CPU
+			const auto fd = syscall(SYS_perf_event_open, &attr, 0, -1, 
+				perf_leader, PERF_FLAG_FD_CLOEXEC);
+			if (fd < 0)
+			{
+				perf_error = errno;
+				continue;
+			}
+			perf_fds[i] = static_cast<int>(fd);
+			if (perf_leader < 0)
+				perf_leader = perf_fds[i];
+		}
+#else
+		perf_opened = true;
+#endif // GTEST_POLICY_PERF_COUNTERS_AVAILABLE
+		return perf_leader >= 0;
+	}
+
+#ifdef GTEST_POLICY_PERF_COUNTERS_AVAILABLE
+	// Reads a counter scaled to the time enabled, returns false if it was 
+	// never scheduled while enabled and hence not measured
+	static bool ReadPerfCounter(int fd, std::uint64_t& value) noexcept
+	{
+		struct
+		{
+			std::uint64_t value;
+			std::uint64_t time_enabled;
+			std::uint64_t time_running;
+		} data;
+		if (read(fd, &data, sizeof(data)) != sizeof(data) || 
+			data.time_running == 0u)
+			return false;
+		value = data.value;
+		if (data.time_running < data.time_enabled)
+		{
+			value = static_cast<std::uint64_t>(
+				static_cast<long double>(data.value) * data.time_enabled /
+				data.time_running);
+		}
+		return true;
+	}
+#endif // GTEST_POLICY_PERF_COUNTERS_AVAILABLE
+
+	class PerfCounterMonitor : public detail::PolicyMonitor
+	{
+	public:
+		PerfCounterMonitor()
+			: usage_()
+		{ }
+
+		void Start() override
+		{
+			perf_requested = true;
+			if (!OpenPerfCounters())
+				return; // skipped, notice is given at end of test
+#ifdef GTEST_POLICY_PERF_COUNTERS_AVAILABLE
+			ioctl(perf_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+			ioctl(perf_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif // GTEST_POLICY_PERF_COUNTERS_AVAILABLE
+		}
+
+		bool Stop() override
+		{
+			usage_ = detail::PolicyUsage();
+			for (auto& measured : perf_measured)
+				measured = false;
+			if (perf_leader < 0)
+				return false;
+#ifdef GTEST_POLICY_PERF_COUNTERS_AVAILABLE
+			ioctl(perf_leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+			for (std::size_t i = 0; i < detail::PolicyUsage::max_metrics; ++i)
+			{
+				std::uint64_t value = 0u;
+				perf_measured[i] = perf_fds[i] >= 0 && 
+					ReadPerfCounter(perf_fds[i], value);
+				if (perf_measured[i])
+					usage_.metrics[i] = value;
+			}
+#endif // GTEST_POLICY_PERF_COUNTERS_AVAILABLE
+			return true;
+		}
+
+		detail::PolicyUsage Usage() const override
+		{
+			return usage_;
+		}
+
+		void Reset() override
+		{
+			perf_requested = false;
+		}
+
+	private:
+		detail::PolicyUsage usage_;
+	};
+}
+
+gtest_policies::listener::PerfCounterPolicyListener::PerfCounterPolicyListener()
+	: PolicyListener(hardware_counters, 
+		std::make_unique<PerfCounterMonitor>())
+{ }
+
+bool gtest_policies::listener::PerfCounterPolicyListener::IsSupported() noexcept
+{
+	detail::InternalScope scope;
+	return OpenPerfCounters();
+}
+
+const char* gtest_policies::listener::PerfCounterPolicyListener::MetricName(
+	std::size_t metric) const noexcept
+{
+	static const char* const names[] = { "instructions", "cycles", 
+		"branch_misses", "llc_misses" };
+	return metric < sizeof(names) / sizeof(names[0]) ? names[metric] : nullptr;
+}
+
+void gtest_policies::listener::PerfCounterPolicyListener::OnTestEnd(
+	const ::testing::TestInfo& test_info)
+{
+	PolicyListener::OnTestEnd(test_info);
+	if (!perf_requested)
+		return;
+
+	detail::InternalScope scope;
+	if (perf_leader < 0)
+	{
+		// Skipped rather than failed since unavailability is a property of
+		// the environment, e.g. containers or perf_event_paranoid, not the test
+		static bool noticed = false;
+		if (!noticed)
+		{
+			noticed = true;
+#ifdef GTEST_POLICY_PERF_COUNTERS_AVAILABLE
+			std::fprintf(stderr, "NOTICE: gtest_policy::hardware_counters "
+				"is not enforced since hardware performance counters are not "
+				"available (perf_event_open: %s).\n", std::strerror(perf_error));
+#else
+			std::fprintf(stderr, "NOTICE: gtest_policy::hardware_counters "
+				"is not enforced since hardware performance counters are not "
+				"supported on this platform.\n");
+#endif // GTEST_POLICY_PERF_COUNTERS_AVAILABLE
+		}
+		return;
+	}
+
+	// Attach counter values to the test result, e.g. the XML report
+	const auto& usage = Usage();
+	for (std::size_t i = 0; i < detail::PolicyUsage::max_metrics; ++i)
+	{
+		if (perf_measured[i])
+		{
+			::testing::Test::RecordProperty(perf_counter_keys[i], 
+				std::to_string(usage.metrics[i]));
+		}
+	}
+}
+
+void gtest_policies::listener::PerfCounterPolicyListener::OnPolicyViolation()
+{
+	const auto& usage = Usage();
+	const auto& budget = Policy().Budget();
+	auto& ss = ViolationReport();
+	ss << "Policy violation: gtest_policy::hardware_counters\n"
+		"Hardware performance counters exceeded the budget permitted by the "
+		"test policy for this test case. ";
+	for (std::size_t i = 0; i < detail::PolicyUsage::max_metrics; ++i)
+	{
+		ss << perf_counter_names[i] << ": ";
+		if (perf_measured[i])
+			ss << usage.metrics[i];
+		else
+			ss << "n/a";
+		ss << " (budget: " << detail::FormatLimit(budget.metrics[i]) << ")"
+			<< (i + 1u < detail::PolicyUsage::max_metrics ? ", " : ". ");
+	}
+	GTEST_NONFATAL_FAILURE_(ss.c_str());
+}
@@ -0,0 +1,200 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+#include <gtest_policies/gtest_policies.h>
+
+#include "gtest_policies-callstack.h"
+#include "gtest_policies-internal.h"
+
+#include <atomic> // std::atomic
+
+#ifdef GTEST_POLICY_MEMORY_RESOURCE_AVAILABLE
+  #if defined(_MSC_VER)
+    #include <intrin.h> // _ReturnAddress
+    #define GTEST_POLICY_RETURN_ADDRESS() _ReturnAddress()
+  #else
+    #define GTEST_POLICY_RETURN_ADDRESS() __builtin_return_address(0)
+  #endif // defined(_MSC_VER)
+#endif // GTEST_POLICY_MEMORY_RESOURCE_AVAILABLE
+
+namespace gtest_policies
+{
+	// Upstream allocations are only counted while monitoring
+	static std::atomic<bool> upstream_monitoring(false);
+	static std::atomic<std::uint64_t> upstream_count(0u);
+	static std::atomic<std::uint64_t> upstream_bytes(0u);
+	static detail::CallSiteTable upstream_call_sites;
+
+	class UpstreamAllocMonitor : public detail::PolicyMonitor
+	{
+	public:
+		UpstreamAllocMonitor()
+			: usage_()
+		{ }
+
+		void Start() override
+		{
+			detail::WarmUpCallStackCapture();
+			upstream_count.store(0u, std::memory_order_relaxed);
+			upstream_bytes.store(0u, std::memory_order_relaxed);
+			upstream_monitoring.store(true, std::memory_order_seq_cst);
+		}
+
+		bool Stop() override
+		{
+			upstream_monitoring.store(false, std::memory_order_seq_cst);
+			usage_.metrics[0] = upstream_count.load(std::memory_order_relaxed);
+			usage_.metrics[1] = upstream_bytes.load(std::memory_order_relaxed);
+			return usage_.metrics[0] != 0u;
+		}
+
+		detail::PolicyUsage Usage() const override
+		{
+			return usage_;
+		}
+
+		void Reset() override
+		{
+			upstream_call_sites.Clear();
+		}
+
+	private:
+		detail::PolicyUsage usage_;
+	};
+
+#ifdef GTEST_POLICY_MEMORY_RESOURCE_AVAILABLE
+	static inline void CountUpstreamAllocation(
+		std::size_t bytes, const void* caller) noexcept
+	{
+		if (!upstream_monitoring.load(std::memory_order_relaxed) ||
+			detail::IsInternalScope() ||
+			!detail::IsInThreadScope(upstream_allocation.Scope()))
+			return;
+		upstream_count.fetch_add(1u, std::memory_order_relaxed);
+		upstream_bytes.fetch_add(bytes, std::memory_order_relaxed);
+
+		// Pools reach their upstream via the standard library, hence call 
+		// sites are keyed by the full call stack rather than caller
+		upstream_call_sites.RecordCallStack(bytes, caller);
+	}
+#endif // GTEST_POLICY_MEMORY_RESOURCE_AVAILABLE
+}
+
+#ifdef GTEST_POLICY_MEMORY_RESOURCE_AVAILABLE
+
+///////////////////////////////////////////////////////////////////////////////
+// policy_memory_resource
+///////////////////////////////////////////////////////////////////////////////
+
+gtest_policies::policy_memory_resource::policy_memory_resource(
+	std::pmr::memory_resource* upstream) noexcept :
+	upstream_(upstream)
+{ }
+
+std::pmr::memory_resource* 
+gtest_policies::policy_memory_resource::upstream_resource() const noexcept
+{
+	return upstream_;
+}
+
+void* gtest_policies::policy_memory_resource::do_allocate(
+	std::size_t bytes, std::size_t alignment)
+{
+	void* p = upstream_->allocate(bytes, alignment);
+	CountUpstreamAllocation(bytes, GTEST_POLICY_RETURN_ADDRESS());
+	return p;
+}
+
+void gtest_policies::policy_memory_resource::do_deallocate(
+	void* p, std::size_t bytes, std::size_t alignment)
+{
+	upstream_->deallocate(p, bytes, alignment);
+}
+
+bool gtest_policies::policy_memory_resource::do_is_equal(
+	const std::pmr::memory_resource& other) const noexcept
+{
+	return this == &other;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// policy_arena_resource
+///////////////////////////////////////////////////////////////////////////////
+
+gtest_policies::policy_arena_resource::policy_arena_resource(
+	void* buffer, std::size_t size, std::pmr::memory_resource* upstream) :
+	upstream_(upstream),
+	arena_(buffer, size, &upstream_)
+{ }
+
+void gtest_policies::policy_arena_resource::release()
+{
+	arena_.release();
+}
+
+std::pmr::memory_resource* 
+gtest_policies::policy_arena_resource::upstream_resource() const noexcept
+{
+	return upstream_.upstream_resource();
+}
+
+void* gtest_policies::policy_arena_resource::do_allocate(
+	std::size_t bytes, std::size_t alignment)
+{
+	return arena_.allocate(bytes, alignment);
+}
+
+void gtest_policies::policy_arena_resource::do_deallocate(
+	void* p, std::size_t bytes, std::size_t alignment)
+{
+	arena_.deallocate(p, bytes, alignment); // no-op until released
+}
+
+bool gtest_policies::policy_arena_resource::do_is_equal(
+	const std::pmr::memory_resource& other) const noexcept
+{
+	return this == &other;
+}
+
+#endif // GTEST_POLICY_MEMORY_RESOURCE_AVAILABLE
+
+///////////////////////////////////////////////////////////////////////////////
+// UpstreamAllocPolicyListener
+///////////////////////////////////////////////////////////////////////////////
+
+gtest_policies::listener::UpstreamAllocPolicyListener::UpstreamAllocPolicyListener()
+	: PolicyListener(upstream_allocation, std::make_unique<UpstreamAllocMonitor>())
+{ }
+
+const char* gtest_policies::listener::UpstreamAllocPolicyListener::MetricName(
+	std::size_t metric) const noexcept
+{
+	static const char* const names[] = { 
+		"upstream_allocations", "upstream_bytes" };
+	return metric < sizeof(names) / sizeof(names[0]) ? names[metric] : nullptr;
+}
+
+void gtest_policies::listener::UpstreamAllocPolicyListener::OnPolicyViolation()
+{
+	const auto& usage = Usage();
+	const auto& budget = Policy().Budget();
+	auto& ss = ViolationReport();
+	ss << "Policy violation: gtest_policy::upstream_allocation\n";
+	if (budget.metrics[0] == 0u)
+	{
+		ss << "Allocating from the upstream of a memory resource is not "
+			"permitted by the test policy for this test case. ";
+	}
+	else
+	{
+		ss << "Allocating from the upstream of a memory resource exceeded the "
+			"budget permitted by the test policy for this test case. ";
+	}
+	ss << "Upstream allocations: " << usage.metrics[0]
+		<< " (budget: " << detail::FormatLimit(budget.metrics[0]) << "), "
+		<< "bytes: " << usage.metrics[1]
+		<< " (budget: " << detail::FormatLimit(budget.metrics[1]) << "). ";
+	detail::DescribeCallSites(ss, upstream_call_sites, "upstream allocation", 5u);
+	GTEST_NONFATAL_FAILURE_(ss.c_str());
+}
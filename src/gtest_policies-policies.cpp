@@ -4,19 +4,79 @@
 
 #include "gtest_policies/gtest_policies.h"
 
+#include "gtest_policies-internal.h"
+
+#include <cstdlib> // std::abort
+
+namespace
+{
+	// Policies in order of registration. Kept contiguous so that Apply() 
+	// only visits enabled policies, and trivially destructible since 
+	// listeners may be destroyed during static destruction.
+	const std::size_t max_policies = 64u;
+	gtest_policies::PolicyContext* active_policies[max_policies];
+	std::size_t active_count = 0u;
+}
+
 gtest_policies::PolicyContext
 	gtest_policies::dynamic_memory_allocation = gtest_policies::PolicyContext();
+gtest_policies::PolicyContext
+	gtest_policies::peak_heap_usage = gtest_policies::PolicyContext(nullptr, false);
+gtest_policies::PolicyContext
+	gtest_policies::memory_leaks = gtest_policies::PolicyContext(nullptr, false);
+gtest_policies::PolicyContext
+	gtest_policies::blocking_io = gtest_policies::PolicyContext(nullptr, false);
+gtest_policies::PolicyContext
+	gtest_policies::lock_acquisition = gtest_policies::PolicyContext(nullptr, false);
+gtest_policies::PolicyContext
+	gtest_policies::thread_creation = gtest_policies::PolicyContext(nullptr, false);
 gtest_policies::PolicyContext
 	gtest_policies::standard_output = gtest_policies::PolicyContext();
 gtest_policies::PolicyContext
 	gtest_policies::standard_error = gtest_policies::PolicyContext();
+gtest_policies::TimePolicyContext
+	gtest_policies::execution_time = gtest_policies::TimePolicyContext();
+gtest_policies::PolicyContext
+	gtest_policies::resource_usage = gtest_policies::PolicyContext(nullptr, false);
+gtest_policies::PolicyContext
+	gtest_policies::hardware_counters = gtest_policies::PolicyContext(nullptr, false);
+gtest_policies::PolicyContext
+	gtest_policies::upstream_allocation = gtest_policies::PolicyContext();
 
-void gtest_policies::Apply() noexcept
+void gtest_policies::detail::RegisterPolicy(PolicyContext& policy) noexcept
+{
+	for (std::size_t i = 0; i < active_count; ++i)
+	{
+		if (active_policies[i] == &policy)
+			return; // already registered
+	}
+	if (active_count == max_policies)
+		std::abort(); // too many policies
+	active_policies[active_count++] = &policy;
+}
+
+void gtest_policies::detail::UnregisterPolicy(PolicyContext& policy) noexcept
 {
-	gtest_policies::dynamic_memory_allocation.Apply();
-	gtest_policies::standard_output.Apply();
-	gtest_policies::standard_error.Apply();
+	std::size_t i = 0;
+	while (i < active_count && active_policies[i] != &policy)
+		++i;
+	if (i == active_count)
+		return; // not registered
+	
+	// Preserve order of registration
+	for (--active_count; i < active_count; ++i)
+		active_policies[i] = active_policies[i + 1u];
 }
 
-//gtest_policies::PolicyContext gtest_policies::xxx = gtest_policies::PolicyContext();
-//gtest_policies::PolicyContext gtest_policies::xxx = gtest_policies::PolicyContext();
\ No newline at end of file
+void gtest_policies::detail::ForEachPolicy(
+	void (*func)(PolicyContext& policy)) noexcept
+{
+	for (std::size_t i = 0; i < active_count; ++i)
+		func(*active_policies[i]);
+}
+
+void gtest_policies::Apply() noexcept
+{
+	for (std::size_t i = 0; i < active_count; ++i)
+		active_policies[i]->Apply();
+}
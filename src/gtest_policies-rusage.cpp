@@ -0,0 +1,114 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+#include <gtest_policies/gtest_policies.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #define GTEST_POLICY_RUSAGE_AVAILABLE
+  #include <sys/resource.h> // getrusage
+  #if defined(RUSAGE_THREAD)
+    // Only account the thread running the test
+    #define GTEST_POLICY_RUSAGE_WHO RUSAGE_THREAD
+  #else
+    #define GTEST_POLICY_RUSAGE_WHO RUSAGE_SELF
+  #endif
+#else
+  #ifndef GTEST_POLICY_SILENCE_WARNINGS
+    #pragma message ( \
+      "WARNING: gtest_policy::resource_usage policy." \
+      "Page fault and context switch counters not supported on this compiler/platform.")
+  #endif // GTEST_POLICY_SILENCE_WARNINGS
+#endif
+
+namespace gtest_policies
+{
+	// Returns minor page faults, major page faults, voluntary context switches
+	// and involuntary context switches so far, or zeros if not supported.
+	static detail::PolicyUsage ResourceUsage() noexcept
+	{
+		detail::PolicyUsage usage = detail::PolicyUsage();
+#ifdef GTEST_POLICY_RUSAGE_AVAILABLE
+		rusage ru;
+		if (getrusage(GTEST_POLICY_RUSAGE_WHO, &ru) == 0)
+		{
+			usage.metrics[0] = static_cast<std::uint64_t>(ru.ru_minflt);
+			usage.metrics[1] = static_cast<std::uint64_t>(ru.ru_majflt);
+			usage.metrics[2] = static_cast<std::uint64_t>(ru.ru_nvcsw);
+			usage.metrics[3] = static_cast<std::uint64_t>(ru.ru_nivcsw);
+		}
+#endif // GTEST_POLICY_RUSAGE_AVAILABLE
+		return usage;
+	}
+
+	class ResourceUsageMonitor : public detail::PolicyMonitor
+	{
+	public:
+		ResourceUsageMonitor()
+			: start_(), usage_()
+		{ }
+
+		void Start() override
+		{
+			start_ = ResourceUsage();
+		}
+
+		bool Stop() override
+		{
+			const auto end = ResourceUsage();
+			bool changed = false;
+			for (std::size_t i = 0; i < detail::PolicyUsage::max_metrics; ++i)
+			{
+				usage_.metrics[i] = end.metrics[i] > start_.metrics[i] ?
+					end.metrics[i] - start_.metrics[i] : 0u;
+				changed = changed || usage_.metrics[i] != 0u;
+			}
+			return changed;
+		}
+
+		detail::PolicyUsage Usage() const override
+		{
+			return usage_;
+		}
+
+	private:
+		detail::PolicyUsage start_;
+		detail::PolicyUsage usage_;
+	};
+}
+
+gtest_policies::listener::ResourceUsagePolicyListener::ResourceUsagePolicyListener()
+	: PolicyListener(resource_usage, 
+		std::make_unique<ResourceUsageMonitor>())
+{ }
+
+const char* gtest_policies::listener::ResourceUsagePolicyListener::MetricName(
+	std::size_t metric) const noexcept
+{
+	static const char* const names[] = { "minor_page_faults", 
+		"major_page_faults", "voluntary_context_switches", 
+		"involuntary_context_switches" };
+	return metric < sizeof(names) / sizeof(names[0]) ? names[metric] : nullptr;
+}
+
+void gtest_policies::listener::ResourceUsagePolicyListener::OnPolicyViolation()
+{
+	static const char* const names[detail::PolicyUsage::max_metrics] = {
+		"Minor page faults", "major page faults", 
+		"voluntary context switches", "involuntary context switches"
+	};
+
+	const auto& usage = Usage();
+	const auto& budget = Policy().Budget();
+	auto& ss = ViolationReport();
+	ss << "Policy violation: gtest_policy::resource_usage\n"
+		"Page faults or context switches exceeded the budget permitted by "
+		"the test policy for this test case. ";
+	for (std::size_t i = 0; i < detail::PolicyUsage::max_metrics; ++i)
+	{
+		ss << names[i] << ": " << usage.metrics[i] << " (budget: " 
+			<< detail::FormatLimit(budget.metrics[i]) << ")"
+			<< (i + 1u < detail::PolicyUsage::max_metrics ? ", " : ". ");
+	}
+	GTEST_NONFATAL_FAILURE_(ss.c_str());
+}
@@ -0,0 +1,300 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+#include <gtest_policies/gtest_policies.h>
+
+#include "gtest_policies-callstack.h"
+#include "gtest_policies-internal.h"
+
+#include <atomic> // std::atomic
+
+#if defined(__GLIBC__) && defined(__LP64__) && \
+    !defined(GTEST_POLICY_DISABLE_THREAD_HOOKS)
+  // pthread_create is interposed by defining it in the executable and 
+  // forwarding to the next definition, i.e. libc, found via dlsym. This also
+  // covers std::thread and std::async.
+  #define GTEST_POLICY_THREAD_HOOKS_AVAILABLE
+  #include <pthread.h> // pthread_create
+#else
+  #ifndef GTEST_POLICY_SILENCE_WARNINGS
+    #pragma message ( \
+      "WARNING: gtest_policy::thread_creation policy." \
+      "Thread creation detection not supported on this compiler/platform.")
+  #endif // GTEST_POLICY_SILENCE_WARNINGS
+#endif
+
+#if defined(__linux__)
+  #define GTEST_POLICY_PROC_THREADS_AVAILABLE
+  #include <cstring>  // std::strrchr
+  #include <fcntl.h>  // open
+  #include <time.h>   // nanosleep
+  #include <unistd.h> // read, close
+#endif // defined(__linux__)
+
+namespace gtest_policies
+{
+#ifdef GTEST_POLICY_THREAD_HOOKS_AVAILABLE
+	// Threads are only counted while monitoring
+	static std::atomic<bool> thread_monitoring(false);
+	static std::atomic<std::uint64_t> threads_created(0u);
+	static detail::CallSiteTable thread_call_sites;
+
+	// Threads created by the process whether monitored or not, used to tell
+	// whether a thread may have been joined since the policy was applied
+	static std::atomic<std::uint64_t> threads_started(0u);
+
+	// Threads created by threads in a test thread scope inherit the scope 
+	// via a trampoline. Arguments of the trampoline are passed in slots of a
+	// preallocated array since allocating would be accounted to the test. 
+	// If all slots are in use the created thread does not inherit the scope.
+	struct ThreadStart
+	{
+		std::atomic<bool> used;
+		void* (*start_routine)(void*);
+		void* arg;
+		std::uint64_t test;
+	};
+
+	static const std::size_t thread_start_count = 64u;
+	static ThreadStart thread_starts[thread_start_count];
+
+	static ThreadStart* AcquireThreadStart() noexcept
+	{
+		for (auto& start : thread_starts)
+		{
+			if (!start.used.load(std::memory_order_relaxed) &&
+				!start.used.exchange(true, std::memory_order_acquire))
+				return &start;
+		}
+		return nullptr;
+	}
+
+	static void* StartThreadInScope(void* arg)
+	{
+		auto& start = *static_cast<ThreadStart*>(arg);
+		const auto start_routine = start.start_routine;
+		const auto start_arg = start.arg;
+		detail::thread_scope_state.test = start.test;
+		detail::thread_scope_state.spawned = true;
+		start.used.store(false, std::memory_order_release);
+		return start_routine(start_arg);
+	}
+#endif // GTEST_POLICY_THREAD_HOOKS_AVAILABLE
+
+#ifdef GTEST_POLICY_PROC_THREADS_AVAILABLE
+	// Returns the number of threads of the process, or zero if unknown. Reads
+	// num_threads of /proc/self/stat, which is equivalent to the number of 
+	// entries of /proc/self/task, without allocating memory.
+	static std::uint64_t CountThreads() noexcept
+	{
+		const int fd = open("/proc/self/stat", O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			return 0u;
+		char buffer[1024];
+		const auto n = read(fd, buffer, sizeof(buffer) - 1u);
+		close(fd);
+		if (n <= 0)
+			return 0u;
+		buffer[n] = '\0';
+
+		// Executable name in parentheses may contain spaces, fields after it
+		// start with state (field 3) and num_threads is field 20.
+		const char* p = std::strrchr(buffer, ')');
+		if (p == nullptr)
+			return 0u;
+		for (int field = 2; field < 20 && *p != '\0'; ++p)
+		{
+			if (*p == ' ')
+				++field;
+		}
+		std::uint64_t threads = 0u;
+		for (; *p >= '0' && *p <= '9'; ++p)
+			threads = threads * 10u + static_cast<std::uint64_t>(*p - '0');
+		return threads;
+	}
+#endif // GTEST_POLICY_PROC_THREADS_AVAILABLE
+
+	// Counts threads created while denied and threads alive at the end of 
+	// the test which were not alive when the policy was first applied.
+	class ThreadMonitor : public detail::PolicyMonitor
+	{
+	public:
+		ThreadMonitor()
+			: usage_(), baseline_(0u), started_at_(0u), started_(false)
+		{ }
+
+		void Start() override
+		{
+			if (!started_)
+			{
+				started_ = true;
+#ifdef GTEST_POLICY_PROC_THREADS_AVAILABLE
+				baseline_ = CountThreads();
+#endif // GTEST_POLICY_PROC_THREADS_AVAILABLE
+#ifdef GTEST_POLICY_THREAD_HOOKS_AVAILABLE
+				started_at_ = threads_started.load(std::memory_order_relaxed);
+#endif // GTEST_POLICY_THREAD_HOOKS_AVAILABLE
+			}
+#ifdef GTEST_POLICY_THREAD_HOOKS_AVAILABLE
+			detail::WarmUpCallStackCapture();
+			threads_created.store(0u, std::memory_order_relaxed);
+			thread_monitoring.store(true, std::memory_order_seq_cst);
+#endif // GTEST_POLICY_THREAD_HOOKS_AVAILABLE
+		}
+
+		bool Stop() override
+		{
+			usage_ = detail::PolicyUsage();
+#ifdef GTEST_POLICY_THREAD_HOOKS_AVAILABLE
+			thread_monitoring.store(false, std::memory_order_seq_cst);
+			usage_.metrics[0] = threads_created.load(std::memory_order_relaxed);
+#endif // GTEST_POLICY_THREAD_HOOKS_AVAILABLE
+			return usage_.metrics[0] != 0u;
+		}
+
+		bool Finish() override
+		{
+			usage_ = detail::PolicyUsage();
+			if (!started_)
+				return false;
+			started_ = false;
+#ifdef GTEST_POLICY_PROC_THREADS_AVAILABLE
+			if (baseline_ == 0u)
+				return false; // unknown
+
+			// A joined thread may still be listed for a short while since 
+			// pthread_join returns when the thread has released its stack,
+			// slightly before it has been reaped by the kernel, hence retry
+			// for up to roughly 0.5 ms if threads have been created since 
+			// the policy was applied.
+			auto threads = CountThreads();
+			auto retries = JoinMayBePending() ? 10 : 0;
+			for (; retries > 0 && threads > baseline_; --retries)
+			{
+				const timespec delay = { 0, 50000 }; // 50 us
+				nanosleep(&delay, nullptr);
+				threads = CountThreads();
+			}
+			if (threads > baseline_)
+				usage_.metrics[1] = threads - baseline_;
+#endif // GTEST_POLICY_PROC_THREADS_AVAILABLE
+			return usage_.metrics[1] != 0u;
+		}
+
+		detail::PolicyUsage Usage() const override
+		{
+			return usage_;
+		}
+
+		void Reset() override
+		{
+			started_ = false;
+#ifdef GTEST_POLICY_THREAD_HOOKS_AVAILABLE
+			thread_call_sites.Clear();
+#endif // GTEST_POLICY_THREAD_HOOKS_AVAILABLE
+		}
+
+	private:
+		bool JoinMayBePending() const noexcept
+		{
+#ifdef GTEST_POLICY_THREAD_HOOKS_AVAILABLE
+			return threads_started.load(std::memory_order_relaxed) != 
+				started_at_;
+#else
+			return true; // unknown
+#endif // GTEST_POLICY_THREAD_HOOKS_AVAILABLE
+		}
+
+		detail::PolicyUsage usage_;
+		std::uint64_t baseline_;
+		std::uint64_t started_at_;
+		bool started_;
+	};
+}
+
+#ifdef GTEST_POLICY_THREAD_HOOKS_AVAILABLE
+
+extern "C" int pthread_create(pthread_t* thread, const pthread_attr_t* attr,
+	void* (*start_routine)(void*), void* arg) noexcept
+{
+	using namespace gtest_policies;
+	static std::atomic<void*> next(nullptr);
+	const auto create = reinterpret_cast<decltype(&pthread_create)>(
+		detail::NextSymbol(next, "pthread_create"));
+
+	// Creating thread is in its test thread scope if not yet ended
+	const auto& state = detail::thread_scope_state;
+	ThreadStart* start = nullptr;
+	if (state.test == detail::test_thread_scope.load(std::memory_order_relaxed))
+		start = AcquireThreadStart();
+
+	int result;
+	if (start != nullptr)
+	{
+		start->start_routine = start_routine;
+		start->arg = arg;
+		start->test = state.test;
+		result = create(thread, attr, StartThreadInScope, start);
+		if (result != 0)
+			start->used.store(false, std::memory_order_release);
+	}
+	else
+	{
+		result = create(thread, attr, start_routine, arg);
+	}
+
+	if (result == 0)
+		threads_started.fetch_add(1u, std::memory_order_relaxed);
+	if (result == 0 && 
+		thread_monitoring.load(std::memory_order_relaxed) &&
+		!detail::IsInternalScope() &&
+		detail::IsInThreadScope(thread_creation.Scope()))
+	{
+		threads_created.fetch_add(1u, std::memory_order_relaxed);
+
+		// std::thread creates threads via the C++ runtime, hence call sites
+		// are keyed by the full call stack rather than caller
+		thread_call_sites.RecordCallStack(0u, __builtin_return_address(0));
+	}
+	return result;
+}
+
+#endif // GTEST_POLICY_THREAD_HOOKS_AVAILABLE
+
+gtest_policies::listener::ThreadPolicyListener::ThreadPolicyListener()
+	: PolicyListener(thread_creation, std::make_unique<ThreadMonitor>())
+{ }
+
+const char* gtest_policies::listener::ThreadPolicyListener::MetricName(
+	std::size_t metric) const noexcept
+{
+	static const char* const names[] = { "threads_created", "threads_alive" };
+	return metric < sizeof(names) / sizeof(names[0]) ? names[metric] : nullptr;
+}
+
+void gtest_policies::listener::ThreadPolicyListener::OnPolicyViolation()
+{
+	const auto& usage = Usage();
+	const auto& budget = Policy().Budget();
+	auto& ss = ViolationReport();
+	ss << "Policy violation: gtest_policy::thread_creation\n";
+	if (budget.metrics[0] == 0u && budget.metrics[1] == 0u)
+	{
+		ss << "Creating threads is not permitted by the test policy for this "
+			"test case. ";
+	}
+	else
+	{
+		ss << "Creating threads exceeded the budget permitted by the test "
+			"policy for this test case. ";
+	}
+	ss << "Threads created: " << usage.metrics[0]
+		<< " (budget: " << detail::FormatLimit(budget.metrics[0]) << "), "
+		<< "threads alive at end of test: " << usage.metrics[1]
+		<< " (budget: " << detail::FormatLimit(budget.metrics[1]) << "). ";
+#ifdef GTEST_POLICY_THREAD_HOOKS_AVAILABLE
+	detail::DescribeCallSites(ss, thread_call_sites, "thread creation", 5u);
+#endif // GTEST_POLICY_THREAD_HOOKS_AVAILABLE
+	GTEST_NONFATAL_FAILURE_(ss.c_str());
+}
@@ -0,0 +1,147 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+#include <gtest_policies/gtest_policies.h>
+
+#include <chrono> // std::chrono::steady_clock
+
+#if defined(_WIN32)
+  #ifndef NOMINMAX
+    #define NOMINMAX 1
+  #endif // NOMINMAX
+  #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+  #endif // WIN32_LEAN_AND_MEAN
+  #include <Windows.h> // GetThreadTimes
+  #define GTEST_POLICY_THREAD_CPU_TIME_AVAILABLE
+#else
+  #include <time.h> // clock_gettime
+  #if defined(CLOCK_THREAD_CPUTIME_ID)
+    #define GTEST_POLICY_THREAD_CPU_TIME_AVAILABLE
+  #endif
+#endif
+
+namespace gtest_policies
+{
+	// Returns CPU time consumed by the calling thread in nanoseconds, or zero
+	// if not supported on this platform.
+	static std::uint64_t ThreadCpuTime() noexcept
+	{
+#if defined(_WIN32)
+		FILETIME creation, exit, kernel, user;
+		if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+			return 0u;
+		const auto to_100ns = [](const FILETIME& t) {
+			return (static_cast<std::uint64_t>(t.dwHighDateTime) << 32u) | 
+				t.dwLowDateTime;
+		};
+		return (to_100ns(kernel) + to_100ns(user)) * 100u;
+#elif defined(GTEST_POLICY_THREAD_CPU_TIME_AVAILABLE)
+		timespec ts;
+		if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+			return 0u;
+		return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000u + 
+			static_cast<std::uint64_t>(ts.tv_nsec);
+#else
+		return 0u;
+#endif
+	}
+
+	class ExecutionTimeMonitor : public detail::PolicyMonitor
+	{
+	public:
+		ExecutionTimeMonitor()
+			: wall_start_(), cpu_start_(0u), wall_time_(0u), cpu_time_(0u)
+		{ }
+
+		void Start() override
+		{
+			cpu_start_ = ThreadCpuTime();
+			wall_start_ = std::chrono::steady_clock::now();
+		}
+
+		bool Stop() override
+		{
+			const auto wall_end = std::chrono::steady_clock::now();
+			const auto cpu_end = ThreadCpuTime();
+			wall_time_ = static_cast<std::uint64_t>(
+				std::chrono::duration_cast<std::chrono::nanoseconds>(
+					wall_end - wall_start_).count());
+			cpu_time_ = cpu_end > cpu_start_ ? cpu_end - cpu_start_ : 0u;
+			return true; // time always elapses
+		}
+
+		detail::PolicyUsage Usage() const override
+		{
+			detail::PolicyUsage usage = { { wall_time_, cpu_time_ } };
+			return usage;
+		}
+
+	private:
+		std::chrono::steady_clock::time_point wall_start_;
+		std::uint64_t cpu_start_;
+		std::uint64_t wall_time_;
+		std::uint64_t cpu_time_;
+	};
+
+	// Duration in nanoseconds formatted for reporting in milliseconds
+	struct Duration
+	{
+		std::uint64_t ns;
+	};
+
+	static Duration FormatDuration(std::uint64_t ns) noexcept
+	{
+		Duration duration = { ns };
+		return duration;
+	}
+
+	static detail::ReportBuffer& operator<<(detail::ReportBuffer& report, 
+		Duration duration) noexcept
+	{
+		if (duration.ns == unlimited)
+			return report << "unlimited";
+		
+		// Fixed point with three decimals, e.g. "1.250 ms"
+		const auto us = (duration.ns + 500u) / 1000u;
+		const auto fraction = static_cast<unsigned>(us % 1000u);
+		const char decimals[] = { '.', 
+			static_cast<char>('0' + fraction / 100u),
+			static_cast<char>('0' + fraction / 10u % 10u),
+			static_cast<char>('0' + fraction % 10u) };
+		report << static_cast<unsigned long long>(us / 1000u);
+		report.Append(decimals, sizeof(decimals));
+		return report << " ms";
+	}
+}
+
+gtest_policies::listener::ExecTimePolicyListener::ExecTimePolicyListener()
+	: PolicyListener(execution_time, 
+		std::make_unique<ExecutionTimeMonitor>())
+{ }
+
+const char* gtest_policies::listener::ExecTimePolicyListener::MetricName(
+	std::size_t metric) const noexcept
+{
+	static const char* const names[] = { "wall_time_ns", "cpu_time_ns" };
+	return metric < sizeof(names) / sizeof(names[0]) ? names[metric] : nullptr;
+}
+
+void gtest_policies::listener::ExecTimePolicyListener::OnPolicyViolation()
+{
+	const auto& usage = Usage();
+	const auto& budget = Policy().Budget();
+	auto& ss = ViolationReport();
+	ss << "Policy violation: gtest_policy::execution_time\n"
+		"Execution time exceeded the budget permitted by the test policy "
+		"for this test case. "
+		"Wall time: " << FormatDuration(usage.metrics[0])
+		<< " (budget: " << FormatDuration(budget.metrics[0]) << "), "
+		<< "CPU time: " << FormatDuration(usage.metrics[1])
+		<< " (budget: " << FormatDuration(budget.metrics[1]) << "). ";
+#ifndef GTEST_POLICY_THREAD_CPU_TIME_AVAILABLE
+	ss << "Thread CPU time is not supported on this platform. ";
+#endif // GTEST_POLICY_THREAD_CPU_TIME_AVAILABLE
+	GTEST_NONFATAL_FAILURE_(ss.c_str());
+}
@@ -4,9 +4,31 @@
 
 #include "gtest_policies-policy_test.h"
 
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <thread>
+
 using namespace gtest_policies;
 using namespace gtest_policies::listener;
 
+// Stores allocated pointers to force allocations to be made where written in
+// optimized builds. Compilers may otherwise reorder or elide allocations of 
+// memory that is not used.
+void* volatile allocated = nullptr;
+
+template<class T>
+T* Use(T* ptr) 
+{ 
+	allocated = ptr;
+	return ptr;
+}
+
 // Instantiate common test for a policy
 INSTANTIATE_TYPED_TEST_SUITE_P(AllocPolicyTest, \
 	PolicyTest, MemAllocPolicyListener);
@@ -71,3 +93,706 @@ TEST_F(DynamicMemoryAllocationPolicyTest,
 
 	free(p); // redemtion for leak
 }
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_fail_test__if_denied_and_allocating_memory_via_calloc)
+{
+	GivenPreTestSequence();
+	policy.Deny();
+	auto p = Use(calloc(4, sizeof(int)));
+	AssertPostTestSequence(true);
+
+	free(p); // redemtion for leak
+}
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_fail_test__if_denied_and_reallocating_memory_via_realloc)
+{
+	auto p = Use(malloc(sizeof(int)));
+	GivenPreTestSequence();
+	policy.Deny();
+	p = Use(realloc(p, 1024 * sizeof(int)));
+	AssertPostTestSequence(true);
+
+	free(p); // redemtion for leak
+}
+
+#ifndef _MSC_VER
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_fail_test__if_denied_and_allocating_memory_via_posix_memalign)
+{
+	GivenPreTestSequence();
+	policy.Deny();
+	void* p = nullptr;
+	ASSERT_EQ(0, posix_memalign(&p, 64, sizeof(int)));
+	AssertPostTestSequence(true);
+
+	free(p); // redemtion for leak
+}
+#endif // _MSC_VER
+
+#ifdef __GLIBC__
+#include <malloc.h>
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_fail_test__if_denied_and_allocating_memory_via_memalign)
+{
+	GivenPreTestSequence();
+	policy.Deny();
+	auto p = Use(memalign(64, sizeof(int)));
+	AssertPostTestSequence(true);
+
+	free(p); // redemtion for leak
+}
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_not_fail_test__if_denied_and_aligned_alloc_fails_due_to_invalid_alignment)
+{
+	GivenPreTestSequence();
+	policy.Deny();
+	volatile std::size_t alignment = 48u; // not a power of two
+	errno = 0;
+	auto p = Use(aligned_alloc(alignment, 64u));
+	const auto error = errno;
+	AssertPostTestSequence(false);
+
+	EXPECT_EQ(nullptr, p);
+	EXPECT_EQ(EINVAL, error);
+}
+#endif // __GLIBC__
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_fail_test__if_denied_and_allocating_memory_via_nothrow_new)
+{
+	GivenPreTestSequence();
+	policy.Deny();
+	auto p = Use(new (std::nothrow) int(0));
+	AssertPostTestSequence(true);
+
+	delete p; // redemtion for leak
+}
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_not_fail_test__if_denied_and_freeing_memory_via_sized_delete)
+{
+	auto p = Use(::operator new(sizeof(int)));
+	GivenPreTestSequence();
+	policy.Deny();
+	::operator delete(p, sizeof(int));
+	AssertPostTestSequence(false);
+}
+
+#ifdef __cpp_aligned_new
+// Over-aligned type as used by SIMD code, allocated via aligned operator new
+struct alignas(64) AlignedVector
+{
+	float values[16];
+};
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_fail_test__if_denied_and_allocating_memory_via_aligned_new)
+{
+	GivenPreTestSequence();
+	policy.Deny();
+	auto p = Use(new AlignedVector());
+	AssertPostTestSequence(true);
+
+	delete p; // redemtion for leak
+}
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_fail_test__if_denied_and_allocating_memory_via_aligned_nothrow_new)
+{
+	GivenPreTestSequence();
+	policy.Deny();
+	auto p = Use(new (std::nothrow) AlignedVector[2]);
+	AssertPostTestSequence(true);
+
+	delete[] p; // redemtion for leak
+}
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_return_aligned_memory__if_allocating_memory_via_aligned_new)
+{
+	GivenPreTestSequence();
+	policy.Grant();
+	auto p = Use(new AlignedVector());
+	EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(p) % alignof(AlignedVector));
+	delete p;
+	AssertPostTestSequence(false);
+	policy.Deny();
+}
+
+#ifdef __GLIBC__
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_report_over_aligned_allocations__if_denied_and_allocating_via_aligned_new)
+{
+	GivenPreTestSequence();
+	policy.Deny();
+	auto p = Use(new AlignedVector());
+	EXPECT_NONFATAL_FAILURE(GivenTestEnd(),
+		"Over-aligned allocations: 1 (max alignment: 64)");
+	GivenTestSuiteEnd();
+	GivenTestProgramEnd();
+
+	delete p; // redemtion for leak
+}
+#endif // __GLIBC__
+#endif // __cpp_aligned_new
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_fail_test__if_allocating_while_denied_and_then_granted)
+{
+	GivenPreTestSequence();
+	policy.Deny();
+	auto p = Use(malloc(sizeof(int)));
+	policy.Grant();
+	AssertPostTestSequence(true);
+
+	free(p); // redemtion for leak
+}
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_not_fail_test__if_denied_and_allocating_within_budget)
+{
+	GivenPreTestSequence();
+	policy.Deny();
+	policy.SetBudget(2u, 2u * sizeof(int));
+	auto p = Use(malloc(sizeof(int)));
+	auto q = Use(malloc(sizeof(int)));
+	AssertPostTestSequence(false);
+
+	free(p); // redemtion for leak
+	free(q);
+}
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_fail_test__if_denied_and_allocation_count_exceeds_budget)
+{
+	GivenPreTestSequence();
+	policy.Deny();
+	policy.SetBudget(1u);
+	auto p = Use(malloc(sizeof(int)));
+	auto q = Use(malloc(sizeof(int)));
+	AssertPostTestSequence(true);
+
+	free(p); // redemtion for leak
+	free(q);
+}
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_fail_test__if_denied_and_allocated_bytes_exceeds_budget)
+{
+	GivenPreTestSequence();
+	policy.Deny();
+	policy.SetBudget(1u, 16u);
+	auto p = Use(malloc(64u));
+	AssertPostTestSequence(true);
+
+	free(p); // redemtion for leak
+}
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_report_usage_and_budget__if_budget_is_exceeded)
+{
+	GivenPreTestSequence();
+	policy.Deny();
+	policy.SetBudget(1u);
+	auto p = Use(malloc(8u));
+	auto q = Use(malloc(8u));
+	policy.Grant(); // stop monitoring before reporting
+	EXPECT_NONFATAL_FAILURE(GivenTestEnd(),
+		"Allocations: 2 (budget: 1), bytes: 16 (budget: unlimited)");
+	GivenTestSuiteEnd();
+	GivenTestProgramEnd();
+
+	free(p); // redemtion for leak
+	free(q);
+}
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_fail_test__if_denied_and_allocating_memory_from_other_thread)
+{
+	std::atomic<int> state(0);
+	void* p = nullptr;
+	std::thread worker([&]() 
+	{
+		while (state.load() != 1) { }
+		p = Use(malloc(sizeof(int)));
+		state.store(2);
+	});
+
+	GivenPreTestSequence();
+	policy.Deny();
+	state.store(1);
+	while (state.load() != 2) { }
+	AssertPostTestSequence(true);
+
+	worker.join();
+	free(p); // redemtion for leak
+}
+
+// Worker thread allocating on request, created before or during the test
+class AllocatingWorker
+{
+public:
+	AllocatingWorker() : state_(0), ptr_(nullptr), thread_([this]()
+	{
+		while (state_.load() != 1) { }
+		ptr_ = Use(malloc(sizeof(int)));
+		state_.store(2);
+	})
+	{ }
+
+	~AllocatingWorker()
+	{
+		thread_.join();
+		free(ptr_);
+	}
+
+	void Allocate()
+	{
+		state_.store(1);
+		while (state_.load() != 2) { }
+	}
+
+private:
+	std::atomic<int> state_;
+	void* ptr_;
+	std::thread thread_;
+};
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_not_fail_test__if_current_thread_scope_and_allocating_from_other_thread)
+{
+	AllocatingWorker worker;
+	policy.SetThreadScope(ThreadScope::current_thread);
+	GivenPreTestSequence();
+	policy.Deny();
+	worker.Allocate();
+	AssertPostTestSequence(false);
+}
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_fail_test__if_current_thread_scope_and_allocating)
+{
+	policy.SetThreadScope(ThreadScope::current_thread);
+	GivenPreTestSequence();
+	policy.Deny();
+	std::make_unique<int>(0);
+	AssertPostTestSequence(true);
+}
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_not_fail_test__if_test_threads_scope_and_allocating_from_thread_created_before_test)
+{
+	AllocatingWorker worker;
+	policy.SetThreadScope(ThreadScope::test_threads);
+	GivenPreTestSequence();
+	policy.Deny();
+	worker.Allocate();
+	AssertPostTestSequence(false);
+}
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_restore_thread_scope__if_test_ends)
+{
+	GivenPreTestSequence();
+	policy.SetThreadScope(ThreadScope::current_thread);
+	policy.Grant();
+	AssertPostTestSequence(false);
+	EXPECT_EQ(ThreadScope::all_threads, policy.Scope());
+}
+
+#ifdef __GLIBC__
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_fail_test__if_test_threads_scope_and_allocating_from_thread_created_during_test)
+{
+	policy.SetThreadScope(ThreadScope::test_threads);
+	GivenPreTestSequence();
+	policy.Grant(); // creating the thread allocates
+	std::unique_ptr<AllocatingWorker> worker(new AllocatingWorker());
+	policy.Deny();
+	worker->Allocate();
+	AssertPostTestSequence(true);
+	worker.reset();
+}
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_not_fail_test__if_current_thread_scope_and_allocating_from_thread_created_during_test)
+{
+	policy.SetThreadScope(ThreadScope::current_thread);
+	GivenPreTestSequence();
+	policy.Grant(); // creating the thread allocates
+	std::unique_ptr<AllocatingWorker> worker(new AllocatingWorker());
+	policy.Deny();
+	worker->Allocate();
+	AssertPostTestSequence(false);
+	worker.reset();
+}
+#endif // __GLIBC__
+
+#ifdef __GLIBC__
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_report_allocation_call_sites__if_denied_and_allocating)
+{
+	void* p[2];
+	GivenPreTestSequence();
+	policy.Deny();
+	for (volatile int i = 0; i < 2; ++i) // same call site, never unrolled
+		p[i] = Use(malloc(8u));
+	policy.Grant(); // stop monitoring before reporting
+	EXPECT_NONFATAL_FAILURE(GivenTestEnd(),
+		"Top 1 of 1 allocation call site(s):\n"
+		"#1: 2 allocation(s), 16 byte(s)\n");
+	GivenTestSuiteEnd();
+	GivenTestProgramEnd();
+
+	free(p[0]); // redemtion for leak
+	free(p[1]);
+}
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_collect_allocation_size_classes__if_denied_and_allocating)
+{
+	void* p[3];
+	GivenPreTestSequence();
+	policy.Deny();
+	policy.SetBudget(unlimited);
+	p[0] = Use(malloc(16u));
+	p[1] = Use(malloc(24u));
+	p[2] = Use(malloc(160000u));
+	policy.Grant();
+	GivenTestEnd();
+	GivenTestSuiteEnd();
+	GivenTestProgramEnd();
+
+	const auto& histogram = listener->Histogram();
+	EXPECT_EQ(2u, histogram.counts[4]);
+	EXPECT_EQ(40u, histogram.bytes[4]);
+	EXPECT_EQ(1u, histogram.counts[17]);
+	EXPECT_EQ(160000u, histogram.bytes[17]);
+	EXPECT_EQ(0u, histogram.counts[5]);
+
+	for (auto ptr : p)
+		free(ptr);
+}
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_not_collect_allocation_size_classes__if_granted_and_allocating)
+{
+	GivenPreTestSequence();
+	policy.Grant();
+	free(Use(malloc(16u)));
+	GivenTestEnd();
+	GivenTestSuiteEnd();
+	GivenTestProgramEnd();
+
+	const auto& histogram = listener->Histogram();
+	for (std::size_t i = 0; i < AllocationHistogram::size_classes; ++i)
+		EXPECT_EQ(0u, histogram.counts[i]);
+}
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_write_allocation_histogram_file__if_file_given)
+{
+	const auto path = ::testing::TempDir() + "gtest_policies_histogram.json";
+	delete listener;
+	listener = new MemAllocPolicyListener(path.c_str());
+
+	void* p;
+	GivenPreTestSequence();
+	policy.Deny();
+	policy.SetBudget(unlimited);
+	p = Use(malloc(16u));
+	policy.Grant();
+	GivenTestEnd();
+	GivenTestSuiteEnd();
+	GivenTestProgramEnd();
+	free(p);
+
+	std::ifstream file(path);
+	std::stringstream json;
+	json << file.rdbuf();
+	EXPECT_NE(std::string::npos, json.str().find(
+		"{\"suite\":\"DynamicMemoryAllocationPolicyTest\","
+		"\"test\":\"should_write_allocation_histogram_file__if_file_given\","
+		"\"histogram\":[{\"min_size\":16,\"max_size\":31,"
+		"\"count\":1,\"bytes\":16}]}"));
+	std::remove(path.c_str());
+}
+#endif // __GLIBC__
+
+// Exposes SetUp() of a compile-time policy set fixture, which is otherwise 
+// invoked by Google Test when running a test of the fixture.
+template<class... Tags>
+class PolicySetFixture : public TestWith<Tags...>
+{
+public:
+	void GivenFixtureSetUp() { this->SetUp(); }
+	void TestBody() override { }
+};
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_fail_test__if_denied_and_allocating_memory_in_fixture_selecting_policy)
+{
+	PolicySetFixture<tag::blocking_io, tag::dynamic_memory_allocation> fixture;
+	GivenTestProgramStart();
+	GivenTestSuiteStart();
+	GivenTestStart();
+	fixture.GivenFixtureSetUp();
+	Use(new int(0));
+	delete static_cast<int*>(allocated);
+	AssertPostTestSequence(true);
+}
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_not_fail_test__if_granted_and_allocating_memory_in_fixture_selecting_policy)
+{
+	PolicySetFixture<tag::dynamic_memory_allocation> fixture;
+	policy.Grant();
+	GivenTestProgramStart();
+	GivenTestSuiteStart();
+	GivenTestStart();
+	fixture.GivenFixtureSetUp();
+	Use(new int(0));
+	delete static_cast<int*>(allocated);
+	AssertPostTestSequence(false);
+	policy.Deny();
+}
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_not_fail_test__if_denied_and_allocating_memory_in_fixture_not_selecting_policy)
+{
+	PolicySetFixture<tag::blocking_io, tag::standard_output> fixture;
+	GivenTestProgramStart();
+	GivenTestSuiteStart();
+	GivenTestStart();
+	fixture.GivenFixtureSetUp();
+	Use(new int(0));
+	delete static_cast<int*>(allocated);
+	AssertPostTestSequence(false);
+}
+
+TEST_F(DynamicMemoryAllocationPolicyTest,
+	should_fail_test__if_denied_and_applied_by_test_in_fixture_not_selecting_policy)
+{
+	PolicySetFixture<> fixture;
+	GivenTestProgramStart();
+	GivenTestSuiteStart();
+	GivenTestStart();
+	fixture.GivenFixtureSetUp();
+	policy.Apply();
+	Use(new int(0));
+	delete static_cast<int*>(allocated);
+	AssertPostTestSequence(true);
+}
+
+// Instantiate common test for a policy
+INSTANTIATE_TYPED_TEST_SUITE_P(PeakHeapPolicyTest, \
+	PolicyTest, MemPeakPolicyListener);
+
+class PeakHeapUsagePolicyTest :
+	public PolicyTest<MemPeakPolicyListener> { };
+
+TEST_F(PeakHeapUsagePolicyTest,
+	should_be_granted__by_default)
+{
+	EXPECT_FALSE(policy.IsDenied());
+	GivenPreTestSequence();
+	auto ptr = Use(std::malloc(1024));
+	std::free(ptr);
+	AssertPostTestSequence(false);
+}
+
+TEST_F(PeakHeapUsagePolicyTest,
+	should_fail_test__if_denied_and_holding_memory_exceeding_budget)
+{
+	policy.Deny();
+	policy.SetBudget(unlimited, 4096u);
+	GivenPreTestSequence();
+	void* blocks[8];
+	for (volatile int i = 0; i < 8; ++i)
+		blocks[i] = Use(std::malloc(1024));
+	for (auto ptr : blocks)
+		std::free(ptr);
+	AssertPostTestSequence(true);
+	EXPECT_EQ(8u, listener->Usage().metrics[0]);
+	EXPECT_GE(listener->Usage().metrics[1], 8u * 1024u);
+}
+
+TEST_F(PeakHeapUsagePolicyTest,
+	should_not_fail_test__if_denied_and_memory_is_freed_within_budget)
+{
+	policy.Deny();
+	policy.SetBudget(unlimited, 4096u);
+	GivenPreTestSequence();
+	for (volatile int i = 0; i < 8; ++i)
+		std::free(Use(std::malloc(1024)));
+	AssertPostTestSequence(false);
+	EXPECT_EQ(1u, listener->Usage().metrics[0]);
+	EXPECT_GE(listener->Usage().metrics[1], 1024u);
+}
+
+TEST_F(PeakHeapUsagePolicyTest,
+	should_not_fail_test__if_denied_and_only_freeing_memory)
+{
+	auto ptr = Use(std::malloc(1024));
+	policy.Deny();
+	GivenPreTestSequence();
+	std::free(ptr);
+	AssertPostTestSequence(false);
+}
+
+TEST_F(PeakHeapUsagePolicyTest,
+	should_fail_test__if_denied_and_freeing_memory_then_allocating_exceeding_budget)
+{
+	auto ptr = Use(std::malloc(4096));
+	policy.Deny();
+	policy.SetBudget(unlimited, 1024u);
+	GivenPreTestSequence();
+	std::free(ptr);
+	ptr = Use(std::malloc(4096));
+	AssertPostTestSequence(true);
+	EXPECT_GE(listener->Usage().metrics[1], 4096u);
+
+	std::free(ptr);
+}
+
+TEST_F(PeakHeapUsagePolicyTest,
+	should_report_peak_of_test__if_denied_multiple_times)
+{
+	policy.Deny();
+	policy.SetBudget(unlimited, 1536u);
+	GivenPreTestSequence();
+	std::free(Use(std::malloc(1024)));
+	policy.Grant();
+	policy.Deny();
+	std::free(Use(std::malloc(1024)));
+	AssertPostTestSequence(false);
+	EXPECT_EQ(1u, listener->Usage().metrics[0]);
+}
+
+TEST_F(PeakHeapUsagePolicyTest,
+	should_subtract_freed_memory__if_reallocating)
+{
+	policy.Deny();
+	policy.SetBudget(1u);
+	GivenPreTestSequence();
+	auto ptr = Use(std::malloc(16));
+	ptr = Use(std::realloc(ptr, 4096));
+	std::free(ptr);
+	AssertPostTestSequence(false);
+	EXPECT_GE(listener->Usage().metrics[1], 4096u);
+}
+
+// Instantiate common test for a policy
+INSTANTIATE_TYPED_TEST_SUITE_P(MemLeakPolicyTest, \
+	PolicyTest, MemLeakPolicyListener);
+
+class MemoryLeakPolicyTest :
+	public PolicyTest<MemLeakPolicyListener> { };
+
+TEST_F(MemoryLeakPolicyTest,
+	should_be_granted__by_default)
+{
+	EXPECT_FALSE(policy.IsDenied());
+	GivenPreTestSequence();
+	auto p = Use(malloc(64u));
+	AssertPostTestSequence(false);
+
+	free(p); // redemtion for leak
+}
+
+TEST_F(MemoryLeakPolicyTest,
+	should_not_fail_test__if_denied_and_freeing_allocated_memory)
+{
+	policy.Deny();
+	GivenPreTestSequence();
+	for (volatile int i = 0; i < 8; ++i)
+		free(Use(malloc(64u)));
+	std::make_unique<int>(0);
+	AssertPostTestSequence(false);
+}
+
+TEST_F(MemoryLeakPolicyTest,
+	should_fail_test__if_denied_and_not_freeing_allocated_memory)
+{
+	policy.Deny();
+	GivenPreTestSequence();
+	auto p = Use(malloc(64u));
+	policy.Grant(); // stop recording before reporting
+	EXPECT_NONFATAL_FAILURE(GivenTestEnd(),
+		"Leaked allocations: 1 (budget: 0), leaked bytes: 64 (budget: 0)");
+	EXPECT_TRUE(listener->IsViolated());
+	GivenTestSuiteEnd();
+	GivenTestProgramEnd();
+
+	free(p); // redemtion for leak
+}
+
+TEST_F(MemoryLeakPolicyTest,
+	should_not_fail_test__if_denied_and_freeing_memory_while_granted)
+{
+	policy.Deny();
+	GivenPreTestSequence();
+	auto p = Use(malloc(64u));
+	policy.Grant();
+	free(p);
+	AssertPostTestSequence(false);
+}
+
+TEST_F(MemoryLeakPolicyTest,
+	should_not_fail_test__if_denied_and_freeing_memory_allocated_before)
+{
+	auto p = Use(malloc(64u));
+	policy.Deny();
+	GivenPreTestSequence();
+	free(p);
+	AssertPostTestSequence(false);
+}
+
+TEST_F(MemoryLeakPolicyTest,
+	should_not_fail_test__if_denied_and_leaking_within_budget)
+{
+	policy.Deny();
+	policy.SetBudget(1u, 64u);
+	GivenPreTestSequence();
+	auto p = Use(malloc(64u));
+	AssertPostTestSequence(false);
+
+	free(p); // redemtion for leak
+}
+
+TEST_F(MemoryLeakPolicyTest,
+	should_track_reallocated_memory__if_denied)
+{
+	policy.Deny();
+	GivenPreTestSequence();
+	auto p = Use(malloc(16u));
+	p = Use(realloc(p, 4096u));
+	free(p);
+	AssertPostTestSequence(false);
+}
+
+#ifdef __GLIBC__
+TEST_F(MemoryLeakPolicyTest,
+	should_report_leaked_bytes_per_call_site__if_denied_and_leaking)
+{
+	void* p[3];
+	policy.Deny();
+	GivenPreTestSequence();
+	for (volatile int i = 0; i < 2; ++i) // same call site, never unrolled
+		p[i] = Use(malloc(8u));
+	p[2] = Use(malloc(32u));
+	policy.Grant(); // stop recording before reporting
+	EXPECT_NONFATAL_FAILURE(GivenTestEnd(),
+		"Top 2 of 2 leaked allocation call site(s):\n"
+		"#1: 1 leaked allocation(s), 32 byte(s)\n");
+	GivenTestSuiteEnd();
+	GivenTestProgramEnd();
+
+	for (auto ptr : p)
+		free(ptr); // redemtion for leak
+}
+#endif // __GLIBC__
@@ -0,0 +1,155 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+#include <gtest/gtest.h>
+
+#include <gtest_policies/gtest_policies.h>
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+using namespace gtest_policies;
+
+template<class T>
+using counting_vector = std::vector<T, counting_allocator<T>>;
+
+using counting_map = std::unordered_map<int, int, std::hash<int>, 
+	std::equal_to<int>, counting_allocator<std::pair<const int, int>>>;
+
+class CountingAllocatorTest : public ::testing::Test 
+{ 
+public:
+	allocation_stats stats;
+};
+
+TEST_F(CountingAllocatorTest, should_not_count__if_not_allocating)
+{
+	counting_vector<int> v{ counting_allocator<int>(stats) };
+	EXPECT_EQ(0u, stats.allocations);
+	EXPECT_EQ(0u, stats.allocated_bytes);
+	EXPECT_EQ(0u, stats.peak_bytes);
+}
+
+TEST_F(CountingAllocatorTest, 
+	should_count_single_allocation__if_vector_reserved_and_filled_within_capacity)
+{
+	counting_vector<int> v{ counting_allocator<int>(stats) };
+	v.reserve(16u);
+	for (int i = 0; i < 16; ++i)
+		v.push_back(i);
+	EXPECT_EQ(1u, stats.allocations);
+	EXPECT_EQ(16u * sizeof(int), stats.allocated_bytes);
+}
+
+TEST_F(CountingAllocatorTest, 
+	should_count_growth__if_vector_exceeds_reserved_capacity)
+{
+	counting_vector<int> v{ counting_allocator<int>(stats) };
+	v.reserve(16u);
+	stats.reset();
+	for (int i = 0; i < 17; ++i)
+		v.push_back(i);
+	EXPECT_EQ(1u, stats.allocations);
+	EXPECT_EQ(1u, stats.deallocations);
+	EXPECT_EQ(16u * sizeof(int), stats.deallocated_bytes);
+}
+
+TEST_F(CountingAllocatorTest, 
+	should_track_live_and_peak_bytes)
+{
+	{
+		counting_vector<int> v{ counting_allocator<int>(stats) };
+		v.reserve(4u);
+		v.reserve(8u);
+		EXPECT_EQ(8u * sizeof(int), stats.live_bytes());
+		EXPECT_EQ(12u * sizeof(int), stats.peak_bytes);
+	}
+	EXPECT_EQ(0u, stats.live_bytes());
+	EXPECT_EQ(stats.allocations, stats.deallocations);
+}
+
+TEST_F(CountingAllocatorTest, 
+	should_restart_peak_from_live_bytes__if_reset)
+{
+	counting_vector<int> v{ counting_allocator<int>(stats) };
+	v.reserve(4u);
+	v.reserve(8u);
+	stats.reset();
+	EXPECT_EQ(0u, stats.allocations);
+	EXPECT_EQ(8u * sizeof(int), stats.live_bytes());
+	EXPECT_EQ(8u * sizeof(int), stats.peak_bytes);
+}
+
+TEST_F(CountingAllocatorTest, 
+	should_count_bytes_allocated_since_reset__if_reset)
+{
+	counting_vector<int> v{ counting_allocator<int>(stats) };
+	v.reserve(4u);
+	stats.reset();
+	EXPECT_EQ(0u, stats.allocated_bytes);
+	v.reserve(8u);
+	EXPECT_EQ(8u * sizeof(int), stats.allocated_bytes);
+	EXPECT_EQ(4u * sizeof(int), stats.deallocated_bytes);
+	EXPECT_EQ(8u * sizeof(int), stats.live_bytes());
+	EXPECT_EQ(12u * sizeof(int), stats.peak_bytes);
+}
+
+TEST_F(CountingAllocatorTest, 
+	should_not_count_array_allocations__if_unordered_map_does_not_rehash)
+{
+	counting_map m{ 0u, std::hash<int>(), std::equal_to<int>(), 
+		counting_allocator<std::pair<const int, int>>(stats) };
+	m.reserve(64u);
+	stats.reset();
+	for (int i = 0; i < 64; ++i)
+		m.emplace(i, i);
+	EXPECT_EQ(64u, stats.allocations); // nodes
+	EXPECT_EQ(0u, stats.array_allocations); // bucket arrays
+}
+
+TEST_F(CountingAllocatorTest, 
+	should_count_array_allocations__if_unordered_map_rehashes)
+{
+	counting_map m{ 0u, std::hash<int>(), std::equal_to<int>(), 
+		counting_allocator<std::pair<const int, int>>(stats) };
+	for (int i = 0; i < 64; ++i)
+		m.emplace(i, i);
+	EXPECT_LT(0u, stats.array_allocations);
+}
+
+TEST_F(CountingAllocatorTest, 
+	should_record_into_same_stats__if_rebound)
+{
+	counting_allocator<int> a(stats);
+	counting_allocator<double>::rebind<char>::other b(a);
+	EXPECT_EQ(&stats, &b.stats());
+	EXPECT_TRUE(a == b);
+
+	std::list<int, counting_allocator<int>> l(a);
+	l.push_back(1);
+	EXPECT_EQ(1u, stats.allocations);
+}
+
+TEST_F(CountingAllocatorTest, 
+	should_not_be_equal__if_recording_into_different_stats)
+{
+	allocation_stats other;
+	EXPECT_TRUE(counting_allocator<int>(stats) != 
+		counting_allocator<int>(other));
+}
+
+TEST_F(CountingAllocatorTest, 
+	should_record_deallocation_into_stats_of_allocation__if_container_move_assigned)
+{
+	allocation_stats other;
+	counting_vector<int> v{ counting_allocator<int>(stats) };
+	counting_vector<int> w{ counting_allocator<int>(other) };
+	v.reserve(4u);
+	w = std::move(v);
+	w = counting_vector<int>{ counting_allocator<int>(other) };
+	EXPECT_EQ(1u, stats.deallocations);
+	EXPECT_EQ(0u, other.allocations);
+	EXPECT_EQ(0u, other.deallocations);
+}
@@ -4,6 +4,8 @@
 
 #include <gtest/gtest.h>
 
+#include <memory>
+
 #include <gtest_policies/gtest_policies.h>
 
 using namespace gtest_policies;
@@ -15,6 +17,16 @@ public:
 	bool Stop() override { return false; }
 };
 
+class CountingMonitor : public gtest_policies::detail::PolicyMonitor
+{
+public:
+	explicit CountingMonitor(int& starts) : starts_(starts) {}
+	void Start() override { ++starts_; }
+	bool Stop() override { return false; }
+private:
+	int& starts_;
+};
+
 class DummyPolicyListener : public gtest_policies::listener::PolicyListener
 {
 public:
@@ -22,6 +34,10 @@ public:
 		: PolicyListener(policy, std::make_unique<DummyMonitor>())
 	{ }
 
+	DummyPolicyListener(gtest_policies::PolicyContext& policy, int& starts)
+		: PolicyListener(policy, std::make_unique<CountingMonitor>(starts))
+	{ }
+
 	virtual ~DummyPolicyListener()
 	{ }
 
@@ -80,3 +96,65 @@ TEST(PolicyContextTest, mark_as_violated__should_do_nothing__if_listener_is_not_
 }
 
 
+TEST(PolicyContextTest, limit__should_return_zero__if_default_constructed)
+{
+	PolicyContext policy;
+	EXPECT_EQ(0u, policy.Limit(0));
+	EXPECT_EQ(0u, policy.Limit(1));
+}
+
+TEST(PolicyContextTest, set_budget__should_set_count_and_bytes_limits)
+{
+	PolicyContext policy;
+	policy.SetBudget(3u, 64u);
+	EXPECT_EQ(3u, policy.Limit(0));
+	EXPECT_EQ(64u, policy.Limit(1));
+}
+
+TEST(PolicyContextTest, set_budget__should_not_limit_bytes__if_only_count_is_given)
+{
+	PolicyContext policy;
+	policy.SetBudget(3u);
+	EXPECT_EQ(3u, policy.Limit(0));
+	EXPECT_EQ(gtest_policies::unlimited, policy.Limit(1));
+}
+
+TEST(PolicyContextTest, reset__should_restore_zero_budget)
+{
+	PolicyContext policy;
+	policy.SetBudget(3u, 64u);
+	policy.Reset();
+	EXPECT_EQ(0u, policy.Limit(0));
+	EXPECT_EQ(0u, policy.Limit(1));
+}
+
+TEST(PolicyContextTest, apply__should_start_monitoring_custom_policy__if_listener_attached)
+{
+	PolicyContext policy;
+	int starts = 0;
+	std::unique_ptr<DummyPolicyListener> listener(
+		new DummyPolicyListener(policy, starts));
+	const auto& unit_test = *::testing::UnitTest::GetInstance();
+	listener->OnTestProgramStart(unit_test);
+	listener->OnTestSuiteStart(*unit_test.current_test_suite());
+	listener->OnTestStart(*unit_test.current_test_info());
+	gtest_policies::Apply();
+	gtest_policies::Apply(); // already applied
+	EXPECT_EQ(1, starts);
+	listener->OnTestEnd(*unit_test.current_test_info());
+	listener->OnTestSuiteEnd(*unit_test.current_test_suite());
+	listener->OnTestProgramEnd(unit_test);
+}
+
+TEST(PolicyContextTest, apply__should_not_start_monitoring_custom_policy__if_listener_destroyed)
+{
+	PolicyContext policy;
+	int starts = 0;
+	std::unique_ptr<DummyPolicyListener> listener(
+		new DummyPolicyListener(policy, starts));
+	const auto& unit_test = *::testing::UnitTest::GetInstance();
+	listener->OnTestProgramStart(unit_test);
+	listener.reset();
+	gtest_policies::Apply();
+	EXPECT_EQ(0, starts);
+}
@@ -0,0 +1,95 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+// Built with _FORTIFY_SOURCE=2, see CMakeLists.txt, as by default in release 
+// builds of several Linux distributions. Reads into buffers of a size known 
+// at compile time are then made through checked variants, e.g. __read_chk 
+// rather than read.
+
+#include "gtest_policies-policy_test.h"
+
+using namespace gtest_policies;
+using namespace gtest_policies::listener;
+
+#if defined(__GLIBC__) && defined(__LP64__) && defined(_FORTIFY_SOURCE)
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+class FortifiedBlockingIoPolicyTest :
+	public PolicyTest<BlockingIoPolicyListener> 
+{ 
+public:
+	void SetUp() override
+	{
+		PolicyTest<BlockingIoPolicyListener>::SetUp();
+		ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+		ASSERT_EQ(4, write(fds[0], "abcd", 4));
+	}
+
+	void TearDown() override
+	{
+		close(fds[0]);
+		close(fds[1]);
+		PolicyTest<BlockingIoPolicyListener>::TearDown();
+	}
+
+	void AssertCalls(const char* calls)
+	{
+		policy.Grant(); // stop monitoring before reporting
+		EXPECT_NONFATAL_FAILURE(GivenTestEnd(), calls);
+		GivenTestSuiteEnd();
+		GivenTestProgramEnd();
+	}
+
+	int fds[2];
+
+	// Size not known at compile time, hence checked at runtime
+	volatile std::size_t size = 4u;
+};
+
+TEST_F(FortifiedBlockingIoPolicyTest, should_fail_test__if_denied_and_reading)
+{
+	char buffer[4];
+	policy.Deny();
+	GivenPreTestSequence();
+	EXPECT_EQ(4, read(fds[1], buffer, size));
+	AssertCalls("Calls per type: read: 1.");
+}
+
+TEST_F(FortifiedBlockingIoPolicyTest, should_fail_test__if_denied_and_reading_at_offset)
+{
+	const auto fd = open("/dev/zero", O_RDONLY);
+	ASSERT_GE(fd, 0);
+	char buffer[4];
+	policy.Deny();
+	GivenPreTestSequence();
+	EXPECT_EQ(4, pread(fd, buffer, size, 0));
+	AssertCalls("Calls per type: read: 1.");
+	close(fd);
+}
+
+TEST_F(FortifiedBlockingIoPolicyTest, should_fail_test__if_denied_and_receiving)
+{
+	char buffer[4];
+	policy.Deny();
+	GivenPreTestSequence();
+	EXPECT_EQ(2, recv(fds[1], buffer, size / 2u, 0));
+	EXPECT_EQ(2, recvfrom(fds[1], buffer, size / 2u, 0, nullptr, nullptr));
+	AssertCalls("Calls per type: recv: 2.");
+}
+
+TEST_F(FortifiedBlockingIoPolicyTest, should_fail_test__if_denied_and_polling)
+{
+	pollfd fd[1] = { { fds[1], POLLIN, 0 } };
+	volatile nfds_t count = 1u;
+	policy.Deny();
+	GivenPreTestSequence();
+	EXPECT_EQ(1, poll(fd, count, 0));
+	AssertCalls("Calls per type: poll: 1.");
+}
+
+#endif // defined(__GLIBC__) && defined(__LP64__) && defined(_FORTIFY_SOURCE)
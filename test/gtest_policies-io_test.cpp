@@ -0,0 +1,187 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+#include "gtest_policies-policy_test.h"
+
+using namespace gtest_policies;
+using namespace gtest_policies::listener;
+
+// Instantiate common test for a policy
+INSTANTIATE_TYPED_TEST_SUITE_P(BlockingIoPolicyTest, \
+	PolicyTest, BlockingIoPolicyListener);
+
+#if defined(__GLIBC__) && defined(__LP64__)
+
+#include <cstdio>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+class BlockingIoPolicyTest :
+	public PolicyTest<BlockingIoPolicyListener> 
+{ 
+public:
+	void SetUp() override
+	{
+		PolicyTest<BlockingIoPolicyListener>::SetUp();
+		ASSERT_EQ(0, pipe(fds));
+	}
+
+	void TearDown() override
+	{
+		close(fds[0]);
+		close(fds[1]);
+		PolicyTest<BlockingIoPolicyListener>::TearDown();
+	}
+
+	int fds[2];
+};
+
+TEST_F(BlockingIoPolicyTest, should_be_granted__by_default)
+{
+	EXPECT_FALSE(policy.IsDenied());
+	GivenPreTestSequence();
+	EXPECT_EQ(1, write(fds[1], "x", 1));
+	AssertPostTestSequence(false);
+}
+
+TEST_F(BlockingIoPolicyTest, should_not_fail_test__if_denied_and_not_doing_io)
+{
+	policy.Deny();
+	GivenPreTestSequence();
+	AssertPostTestSequence(false);
+}
+
+TEST_F(BlockingIoPolicyTest, should_fail_test__if_denied_and_opening_file)
+{
+	policy.Deny();
+	GivenPreTestSequence();
+	const auto fd = open("/dev/null", O_RDONLY);
+	policy.Grant(); // stop monitoring before reporting
+	EXPECT_NONFATAL_FAILURE(GivenTestEnd(), "Calls per type: open: 1.");
+	GivenTestSuiteEnd();
+	GivenTestProgramEnd();
+	close(fd);
+}
+
+TEST_F(BlockingIoPolicyTest, should_fail_test__if_denied_and_opening_file_stream)
+{
+	policy.Deny();
+	GivenPreTestSequence();
+	const auto file = fopen("/dev/null", "r");
+	policy.Grant(); // stop monitoring before reporting
+	EXPECT_NONFATAL_FAILURE(GivenTestEnd(), "Calls per type: open: 1.");
+	GivenTestSuiteEnd();
+	GivenTestProgramEnd();
+	fclose(file);
+}
+
+TEST_F(BlockingIoPolicyTest, should_fail_test__if_denied_and_reading_and_writing)
+{
+	char buffer[4];
+	policy.Deny();
+	GivenPreTestSequence();
+	EXPECT_EQ(4, write(fds[1], "abcd", 4));
+	EXPECT_EQ(4, read(fds[0], buffer, 4));
+	policy.Grant(); // stop monitoring before reporting
+	EXPECT_NONFATAL_FAILURE(GivenTestEnd(), 
+		"Calls: 2 (budget: 0), bytes: 8 (budget: 0). "
+		"Calls per type: read: 1, write: 1.");
+	GivenTestSuiteEnd();
+	GivenTestProgramEnd();
+}
+
+TEST_F(BlockingIoPolicyTest, should_fail_test__if_denied_and_polling)
+{
+	pollfd fd = { fds[0], POLLIN, 0 };
+	policy.Deny();
+	GivenPreTestSequence();
+	EXPECT_EQ(0, poll(&fd, 1, 0));
+	AssertPostTestSequence(true);
+}
+
+TEST_F(BlockingIoPolicyTest, should_fail_test__if_denied_and_syncing)
+{
+	policy.Deny();
+	GivenPreTestSequence();
+	fsync(fds[1]);
+	AssertPostTestSequence(true);
+}
+
+TEST_F(BlockingIoPolicyTest, should_fail_test__if_denied_and_flushing_stream)
+{
+	auto file = tmpfile();
+	ASSERT_NE(nullptr, file);
+	fputs("abcd", file);
+	policy.Deny();
+	GivenPreTestSequence();
+	EXPECT_EQ(0, fflush(file));
+	policy.Grant(); // stop monitoring before reporting
+	EXPECT_NONFATAL_FAILURE(GivenTestEnd(), "Calls per type: write: 1.");
+	GivenTestSuiteEnd();
+	GivenTestProgramEnd();
+	fclose(file);
+}
+
+TEST_F(BlockingIoPolicyTest, should_fail_test__if_denied_and_using_socket)
+{
+	int sockets[2];
+	ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+	char buffer[2];
+	policy.Deny();
+	GivenPreTestSequence();
+	EXPECT_EQ(2, send(sockets[0], "hi", 2, 0));
+	EXPECT_EQ(2, recv(sockets[1], buffer, 2, 0));
+	policy.Grant(); // stop monitoring before reporting
+	EXPECT_NONFATAL_FAILURE(GivenTestEnd(), 
+		"Calls per type: send: 1, recv: 1.");
+	GivenTestSuiteEnd();
+	GivenTestProgramEnd();
+	close(sockets[0]);
+	close(sockets[1]);
+}
+
+TEST_F(BlockingIoPolicyTest, should_not_fail_test__if_denied_and_within_budget)
+{
+	policy.Deny();
+	policy.SetBudget(unlimited, 4u);
+	GivenPreTestSequence();
+	EXPECT_EQ(4, write(fds[1], "abcd", 4));
+	AssertPostTestSequence(false);
+}
+
+TEST_F(BlockingIoPolicyTest, should_not_fail_test__if_granted_and_writing)
+{
+	policy.Grant();
+	GivenPreTestSequence();
+	EXPECT_EQ(4, write(fds[1], "abcd", 4));
+	AssertPostTestSequence(false);
+}
+
+TEST_F(BlockingIoPolicyTest, should_not_count_io__if_forwarding_monitored_output)
+{
+	StdOutPolicyListener stdout_listener(OutputMonitoring::file_descriptor);
+	auto& stdout_policy = stdout_listener.Policy();
+	stdout_policy.Grant();
+	stdout_listener.OnTestProgramStart(*Instance());
+	stdout_listener.OnTestSuiteStart(*Instance()->current_test_case());
+	stdout_listener.OnTestStart(*Instance()->current_test_info());
+
+	policy.Deny();
+	GivenPreTestSequence();
+	stdout_policy.Deny();
+	stdout_policy.SetBudget(unlimited, unlimited);
+	stdout_policy.Apply();
+	printf("Hello printf\n"); // forwarded by drain thread
+	stdout_policy.Grant();
+	AssertPostTestSequence(false);
+
+	stdout_listener.OnTestEnd(*Instance()->current_test_info());
+	stdout_listener.OnTestSuiteEnd(*Instance()->current_test_case());
+	stdout_listener.OnTestProgramEnd(*Instance());
+	stdout_policy.Reset();
+}
+
+#endif // defined(__GLIBC__) && defined(__LP64__)
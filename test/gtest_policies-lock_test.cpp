@@ -0,0 +1,166 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+#include "gtest_policies-policy_test.h"
+
+using namespace gtest_policies;
+using namespace gtest_policies::listener;
+
+// Instantiate common test for a policy
+INSTANTIATE_TYPED_TEST_SUITE_P(LockPolicyTest, \
+	PolicyTest, LockPolicyListener);
+
+#if defined(__GLIBC__) && defined(__LP64__)
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Note that Google Test itself acquires locks, e.g. when querying the 
+// current test, hence tests stop monitoring by granting the policy before
+// ending the test.
+class LockPolicyTest :
+	public PolicyTest<LockPolicyListener> 
+{ 
+public:
+	void AssertGrantedTestEnd(const char* expected)
+	{
+		policy.Grant(); // stop monitoring before reporting
+		EXPECT_NONFATAL_FAILURE(GivenTestEnd(), expected);
+		GivenTestSuiteEnd();
+		GivenTestProgramEnd();
+	}
+
+	std::mutex mutex;
+};
+
+TEST_F(LockPolicyTest, should_be_granted__by_default)
+{
+	EXPECT_FALSE(policy.IsDenied());
+	GivenPreTestSequence();
+	std::lock_guard<std::mutex> lock(mutex);
+	policy.Grant();
+	AssertPostTestSequence(false);
+}
+
+TEST_F(LockPolicyTest, should_not_fail_test__if_denied_and_not_locking)
+{
+	std::atomic<int> value(0);
+	policy.Deny();
+	GivenPreTestSequence();
+	value.fetch_add(1);
+	policy.Grant();
+	AssertPostTestSequence(false);
+}
+
+TEST_F(LockPolicyTest, should_fail_test__if_denied_and_locking_mutex)
+{
+	policy.Deny();
+	GivenPreTestSequence();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+	}
+	AssertGrantedTestEnd(
+		"Calls: 1 (budget: 0), blocking: 0 (budget: 0). "
+		"Calls per type: mutex: 1.");
+}
+
+TEST_F(LockPolicyTest, should_fail_test__if_denied_and_locking_shared_mutex)
+{
+	std::shared_timed_mutex shared;
+	policy.Deny();
+	GivenPreTestSequence();
+	shared.lock_shared();
+	shared.unlock_shared();
+	shared.lock();
+	shared.unlock();
+	AssertGrantedTestEnd("Calls per type: rwlock: 2.");
+}
+
+TEST_F(LockPolicyTest, should_count_blocking_call__if_denied_and_mutex_contended)
+{
+	std::atomic<int> state(0);
+	std::thread owner([&]() 
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		state.store(1);
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	});
+	while (state.load() != 1) { }
+
+	policy.Deny();
+	GivenPreTestSequence();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+	}
+	policy.Grant();
+	owner.join();
+	EXPECT_NONFATAL_FAILURE(GivenTestEnd(), 
+		"Calls: 1 (budget: 0), blocking: 1 (budget: 0).");
+	GivenTestSuiteEnd();
+	GivenTestProgramEnd();
+}
+
+TEST_F(LockPolicyTest, should_fail_test__if_denied_and_waiting_on_condition_variable)
+{
+	std::condition_variable cv;
+	std::unique_lock<std::mutex> lock(mutex);
+	policy.Deny();
+	GivenPreTestSequence();
+	cv.wait_for(lock, std::chrono::milliseconds(1));
+	AssertGrantedTestEnd("condition variable: 1");
+}
+
+#if defined(__x86_64__)
+TEST_F(LockPolicyTest, should_fail_test__if_denied_and_waiting_on_futex)
+{
+	int word = 1;
+	const timespec timeout = { 0, 1000 };
+	policy.Deny();
+	GivenPreTestSequence();
+	syscall(SYS_futex, &word, FUTEX_WAIT_PRIVATE, 1, &timeout, nullptr, 0);
+	AssertGrantedTestEnd("Calls per type: futex: 1.");
+}
+
+TEST_F(LockPolicyTest, should_forward_system_calls__if_denied)
+{
+	int word = 0;
+	policy.Deny();
+	GivenPreTestSequence();
+	EXPECT_EQ(getpid(), syscall(SYS_getpid));
+	EXPECT_EQ(0, syscall(SYS_futex, &word, FUTEX_WAKE_PRIVATE, 1));
+	policy.Grant();
+	AssertPostTestSequence(false);
+}
+#endif // defined(__x86_64__)
+
+TEST_F(LockPolicyTest, should_not_fail_test__if_denied_and_locking_within_budget)
+{
+	policy.Deny();
+	policy.SetBudget(unlimited, 0u); // uncontended locks only
+	GivenPreTestSequence();
+	for (volatile int i = 0; i < 4; ++i)
+		std::lock_guard<std::mutex> lock(mutex);
+	policy.Grant();
+	AssertPostTestSequence(false);
+}
+
+TEST_F(LockPolicyTest, should_not_fail_test__if_granted_and_locking_mutex)
+{
+	policy.Grant();
+	GivenPreTestSequence();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+	}
+	AssertPostTestSequence(false);
+}
+
+#endif // defined(__GLIBC__) && defined(__LP64__)
@@ -0,0 +1,193 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+#include "gtest_policies-policy_test.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace gtest_policies;
+using namespace gtest_policies::listener;
+
+void* volatile metrics_allocated = nullptr;
+
+class MetricsExportTest : public PolicyTest<MemAllocPolicyListener> 
+{ 
+public:
+	void TearDown() override
+	{
+		SetMetricsOutput("");
+		SetBaseline("");
+		std::remove(path.c_str());
+		PolicyTest<MemAllocPolicyListener>::TearDown();
+	}
+
+	void GivenBaseline(const std::string& csv)
+	{
+		std::ofstream file(path);
+		file << csv;
+	}
+
+	void GivenMetricsOutput(const char* format)
+	{
+		SetMetricsOutput((std::string(format) + ":" + path).c_str());
+	}
+
+	void GivenTestAllocating(std::size_t size, std::size_t count = 1u)
+	{
+		GivenPreTestSequence();
+		policy.Deny();
+		policy.SetBudget(unlimited);
+		void* p[2];
+		for (std::size_t i = 0; i < count; ++i)
+			p[i] = metrics_allocated = malloc(size);
+		policy.Grant();
+		for (std::size_t i = 0; i < count; ++i)
+			free(p[i]);
+	}
+
+	void GivenTestAllocatingToEnd(std::size_t size, std::size_t count = 1u)
+	{
+		GivenTestAllocating(size, count);
+		GivenTestEnd();
+		GivenTestSuiteEnd();
+		GivenTestProgramEnd();
+	}
+
+	std::string ReadMetrics() const
+	{
+		std::ifstream file(path);
+		std::stringstream ss;
+		ss << file.rdbuf();
+		return ss.str();
+	}
+
+	const std::string path = ::testing::TempDir() + "gtest_policies_metrics";
+};
+
+#ifdef __GLIBC__
+TEST_F(MetricsExportTest, should_write_json_record__if_json_output_and_denied)
+{
+	GivenMetricsOutput("json");
+	GivenTestAllocatingToEnd(16u);
+
+	const auto json = ReadMetrics();
+	EXPECT_EQ(0u, json.find("{\n  \"tests\": [\n    {\"suite\":"
+		"\"MetricsExportTest\",\"test\":"
+		"\"should_write_json_record__if_json_output_and_denied\","
+		"\"elapsed_ms\":"));
+	EXPECT_NE(std::string::npos, json.find(
+		",\"allocations\":1,\"allocated_bytes\":16}\n  ]\n}\n"));
+}
+
+TEST_F(MetricsExportTest, should_write_csv_record__if_csv_output_and_denied)
+{
+	GivenMetricsOutput("csv");
+	GivenTestAllocatingToEnd(16u);
+
+	const auto csv = ReadMetrics();
+	EXPECT_EQ(0u, csv.find("suite,test,elapsed_ms,allocations,allocated_bytes\n"
+		"MetricsExportTest,should_write_csv_record__if_csv_output_and_denied,"));
+	EXPECT_NE(std::string::npos, csv.find(",1,16\n"));
+}
+
+TEST_F(MetricsExportTest, should_fail_test__if_exceeding_baseline)
+{
+	GivenBaseline("suite,test,elapsed_ms,allocations,allocated_bytes\n"
+		"MetricsExportTest,should_fail_test__if_exceeding_baseline,0,1,16\n");
+	SetBaseline(path.c_str(), 0.1);
+	GivenTestAllocating(16u, 2u);
+	EXPECT_NONFATAL_FAILURE(GivenTestEnd(), 
+		"Performance regression compared to baseline (tolerance: 10%). "
+		"allocations: 2 (baseline: 1), allocated_bytes: 32 (baseline: 16).");
+	GivenTestSuiteEnd();
+	GivenTestProgramEnd();
+}
+
+TEST_F(MetricsExportTest, should_not_fail_test__if_within_baseline_tolerance)
+{
+	GivenBaseline("suite,test,elapsed_ms,allocations,allocated_bytes\n"
+		"MetricsExportTest,should_not_fail_test__if_within_baseline_tolerance,"
+		"0,1,16\n");
+	SetBaseline(path.c_str(), 0.1);
+	GivenTestAllocatingToEnd(17u);
+}
+
+TEST_F(MetricsExportTest, should_not_fail_test__if_not_in_baseline)
+{
+	GivenBaseline("suite,test,elapsed_ms,allocations,allocated_bytes\n"
+		"MetricsExportTest,other,0,0,0\n");
+	SetBaseline(path.c_str(), 0.1);
+	GivenTestAllocatingToEnd(16u);
+}
+
+TEST_F(MetricsExportTest, should_rewrite_baseline__if_rewrite_and_keep_tests_not_run)
+{
+	GivenBaseline("suite,test,elapsed_ms,allocations,allocated_bytes\n"
+		"MetricsExportTest,"
+		"should_rewrite_baseline__if_rewrite_and_keep_tests_not_run,0,1,1\n"
+		"\"Other,suite\",test,5,7,\n");
+	SetBaseline(path.c_str(), 0.1, true);
+	GivenTestAllocatingToEnd(16u, 2u);
+
+	const auto csv = ReadMetrics();
+	EXPECT_EQ(0u, csv.find("suite,test,elapsed_ms,allocations,allocated_bytes\n"
+		"MetricsExportTest,"
+		"should_rewrite_baseline__if_rewrite_and_keep_tests_not_run,"));
+	EXPECT_NE(std::string::npos, csv.find(",2,32\n\"Other,suite\",test,5,7,\n"));
+}
+#endif // __GLIBC__
+
+TEST_F(MetricsExportTest, should_not_write_record__if_never_denied)
+{
+	GivenMetricsOutput("json");
+	policy.Grant();
+	GivenPreTestSequence();
+	GivenTestEnd();
+	GivenTestSuiteEnd();
+	GivenTestProgramEnd();
+	policy.Deny(); // restore default
+
+	EXPECT_EQ("{\n  \"tests\": [\n  ]\n}\n", ReadMetrics());
+}
+
+TEST_F(MetricsExportTest, should_not_write_file__if_disabled)
+{
+	SetMetricsOutput("");
+	GivenTestAllocatingToEnd(16u);
+
+	EXPECT_FALSE(std::ifstream(path).is_open());
+}
+
+TEST(ParseFlagsTest, should_remove_metrics_flag__if_present)
+{
+	char program[] = "test";
+	char flag[] = "--gtest_policies_metrics=";
+	char other[] = "--gtest_filter=*";
+	char* argv[] = { program, flag, other, nullptr };
+	int argc = 3;
+	ParseFlags(&argc, argv);
+
+	EXPECT_EQ(2, argc);
+	EXPECT_STREQ("--gtest_filter=*", argv[1]);
+	EXPECT_EQ(nullptr, argv[2]);
+}
+
+TEST(ParseFlagsTest, should_remove_baseline_flags__if_present)
+{
+	char program[] = "test";
+	char baseline[] = "--gtest_policies_baseline=";
+	char tolerance[] = "--gtest_policies_baseline_tolerance=0.05";
+	char rewrite[] = "--gtest_policies_rewrite_baseline";
+	char* argv[] = { program, baseline, tolerance, rewrite, nullptr };
+	int argc = 4;
+	ParseFlags(&argc, argv);
+	SetBaseline("");
+
+	EXPECT_EQ(1, argc);
+	EXPECT_EQ(nullptr, argv[1]);
+}
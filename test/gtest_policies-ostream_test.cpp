@@ -4,6 +4,8 @@
 
 #include "gtest_policies-policy_test.h"
 
+#include <iomanip>
+
 using namespace gtest_policies;
 using namespace gtest_policies::listener;
 
@@ -67,4 +69,208 @@ TEST_F(StdErrPolicyTest, should_not_fail_test__if_denied_and_writing_to_cout)
 	GivenPreTestSequence();
 	std::cerr << "Hello";
 	AssertPostTestSequence(false);
-}
\ No newline at end of file
+}
+
+TEST_F(StdOutPolicyTest, should_not_fail_test__if_denied_and_writing_within_budget)
+{
+	policy.Deny();
+	policy.SetBudget(5u);
+	GivenPreTestSequence();
+	std::cout << 'H' << 'e' << 'l' << 'l' << 'o';
+	AssertPostTestSequence(false);
+}
+
+TEST_F(StdOutPolicyTest, should_fail_test__if_denied_and_writing_exceeds_byte_budget)
+{
+	policy.Deny();
+	policy.SetBudget(unlimited, 4u);
+	GivenPreTestSequence();
+	std::cout << "Hello";
+	AssertPostTestSequence(true);
+}
+
+TEST_F(StdOutPolicyTest, should_count_character_sequence_as_single_write)
+{
+	policy.Deny();
+	policy.SetBudget(1u, 5u);
+	GivenPreTestSequence();
+	std::cout << "Hello";
+	AssertPostTestSequence(false);
+}
+
+TEST_F(StdOutPolicyTest, should_count_formatted_output_as_single_write)
+{
+	policy.Deny();
+	policy.SetBudget(1u, 16u);
+	GivenPreTestSequence();
+	std::cout << 12345 << std::setw(8) << 1.5 << 'x' << "yz";
+	AssertPostTestSequence(false);
+	EXPECT_EQ(1u, listener->Usage().metrics[0]);
+	EXPECT_EQ(16u, listener->Usage().metrics[1]);
+}
+
+TEST_F(StdOutPolicyTest, should_count_each_flush_as_a_write)
+{
+	policy.Deny();
+	policy.SetBudget(1u);
+	GivenPreTestSequence();
+	std::cout << 1 << std::flush << 2 << std::flush;
+	AssertPostTestSequence(true);
+	EXPECT_EQ(2u, listener->Usage().metrics[0]);
+}
+
+TEST_F(StdOutPolicyTest, should_fail_test__if_denied_and_writing_block_to_cout)
+{
+	const std::string block(4096u, '.');
+	policy.Deny();
+	GivenPreTestSequence();
+	std::cout.write(block.data(), static_cast<std::streamsize>(block.size()));
+	AssertPostTestSequence(true);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+class FdStdOutPolicyListener : public StdOutPolicyListener
+{
+public:
+	FdStdOutPolicyListener() 
+		: StdOutPolicyListener(OutputMonitoring::file_descriptor)
+	{ }
+};
+
+class FdStdErrPolicyListener : public StdErrPolicyListener
+{
+public:
+	FdStdErrPolicyListener()
+		: StdErrPolicyListener(OutputMonitoring::file_descriptor)
+	{ }
+};
+
+// Instantiate common test for a policy
+INSTANTIATE_TYPED_TEST_SUITE_P(FdStdOutPolicyTest, \
+	PolicyTest, FdStdOutPolicyListener);
+
+class FdStdOutPolicyTest :
+	public PolicyTest<FdStdOutPolicyListener> { };
+
+TEST_F(FdStdOutPolicyTest, should_fail_test__if_denied_and_writing_via_printf)
+{
+	policy.Deny();
+	GivenPreTestSequence();
+	printf("Hello printf\n");
+	AssertPostTestSequence(true);
+}
+
+TEST_F(FdStdOutPolicyTest, should_fail_test__if_denied_and_writing_to_file_descriptor)
+{
+	policy.Deny();
+	GivenPreTestSequence();
+	EXPECT_EQ(6, write(1, "Hello\n", 6));
+	AssertPostTestSequence(true);
+}
+
+TEST_F(FdStdOutPolicyTest, should_fail_test__if_denied_and_writing_to_cout)
+{
+	policy.Deny();
+	GivenPreTestSequence();
+	std::cout << "Hello cout\n";
+	AssertPostTestSequence(true);
+}
+
+TEST_F(FdStdOutPolicyTest, should_not_fail_test__if_denied_and_not_writing)
+{
+	policy.Deny();
+	GivenPreTestSequence();
+	fflush(stdout);
+	AssertPostTestSequence(false);
+}
+
+TEST_F(FdStdOutPolicyTest, should_not_fail_test__if_granted_and_writing_via_printf)
+{
+	policy.Grant();
+	GivenPreTestSequence();
+	printf("Hello printf\n");
+	AssertPostTestSequence(false);
+}
+
+TEST_F(FdStdOutPolicyTest, should_not_fail_test__if_denied_and_writing_within_byte_budget)
+{
+	policy.Deny();
+	policy.SetBudget(unlimited, 6u);
+	GivenPreTestSequence();
+	EXPECT_EQ(6, write(1, "Hello\n", 6));
+	AssertPostTestSequence(false);
+}
+
+#ifdef __linux__
+TEST_F(FdStdOutPolicyTest, should_forward_and_count_all_output__if_target_is_slow)
+{
+	// Standard output redirected into a small pipe drained by a slow reader,
+	// i.e. the target is frequently full while forwarding.
+	int target[2];
+	ASSERT_EQ(0, pipe(target));
+	fcntl(target[1], F_SETPIPE_SZ, 4096);
+	fflush(stdout);
+	const int saved = dup(1);
+	dup2(target[1], 1);
+	std::size_t received = 0u;
+	std::thread reader([&]() {
+		char buffer[512];
+		ssize_t n;
+		while ((n = read(target[0], buffer, sizeof(buffer))) > 0)
+		{
+			received += static_cast<std::size_t>(n);
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	});
+
+	const std::string block(1024u, '.');
+	policy.Deny();
+	policy.SetBudget(unlimited, unlimited);
+	GivenPreTestSequence();
+	for (int i = 0; i < 64; ++i)
+		EXPECT_EQ(1024, write(1, block.data(), block.size()));
+	AssertPostTestSequence(false);
+	const auto counted = listener->Usage().metrics[1];
+
+	dup2(saved, 1);
+	close(saved);
+	close(target[1]);
+	reader.join();
+	close(target[0]);
+	EXPECT_EQ(65536u, counted);
+	EXPECT_EQ(65536u, received);
+}
+#endif // __linux__
+
+// Instantiate common test for a policy
+INSTANTIATE_TYPED_TEST_SUITE_P(FdStdErrPolicyTest, \
+	PolicyTest, FdStdErrPolicyListener);
+
+class FdStdErrPolicyTest :
+	public PolicyTest<FdStdErrPolicyListener> { };
+
+TEST_F(FdStdErrPolicyTest, should_fail_test__if_denied_and_writing_via_fputs)
+{
+	policy.Deny();
+	GivenPreTestSequence();
+	fputs("Hello fputs\n", stderr);
+	AssertPostTestSequence(true);
+}
+
+TEST_F(FdStdErrPolicyTest, should_not_fail_test__if_granted_and_writing_via_fputs)
+{
+	policy.Grant();
+	GivenPreTestSequence();
+	fputs("Hello fputs\n", stderr);
+	AssertPostTestSequence(false);
+}
+
+#endif // defined(__unix__) || defined(__APPLE__)
@@ -0,0 +1,108 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+#include "gtest_policies-policy_test.h"
+
+#include <thread>
+
+using namespace gtest_policies;
+using namespace gtest_policies::listener;
+
+namespace
+{
+	void Compute(unsigned iterations)
+	{
+		volatile unsigned counter = 0u;
+		for (unsigned i = 0; i < iterations; ++i)
+			counter = counter + i;
+	}
+}
+
+// Instantiate common test for a policy
+INSTANTIATE_TYPED_TEST_SUITE_P(PerfCounterPolicyTest, \
+	PolicyTest, PerfCounterPolicyListener);
+
+class PerfCounterPolicyTest :
+	public PolicyTest<PerfCounterPolicyListener> { };
+
+TEST_F(PerfCounterPolicyTest, should_be_granted__by_default)
+{
+	EXPECT_FALSE(policy.IsDenied());
+	GivenPreTestSequence();
+	Compute(1000u);
+	AssertPostTestSequence(false);
+}
+
+TEST_F(PerfCounterPolicyTest, should_not_fail_test__if_denied_and_counters_not_supported)
+{
+	if (PerfCounterPolicyListener::IsSupported())
+		GTEST_SKIP() << "Hardware performance counters are available";
+
+	policy.Deny();
+	GivenPreTestSequence();
+	Compute(1000u);
+	AssertPostTestSequence(false);
+}
+
+TEST_F(PerfCounterPolicyTest, should_fail_test__if_denied_and_exceeding_instruction_budget)
+{
+	if (!PerfCounterPolicyListener::IsSupported())
+		GTEST_SKIP() << "Hardware performance counters are not available";
+
+	policy.Deny();
+	policy.SetBudget(1000u, unlimited);
+	policy.SetLimit(2u, unlimited);
+	policy.SetLimit(3u, unlimited);
+	GivenPreTestSequence();
+	Compute(100000u);
+	AssertPostTestSequence(true);
+	EXPECT_GE(listener->Usage().metrics[0], 100000u);
+}
+
+TEST_F(PerfCounterPolicyTest, should_not_fail_test__if_denied_and_within_budget)
+{
+	if (!PerfCounterPolicyListener::IsSupported())
+		GTEST_SKIP() << "Hardware performance counters are not available";
+
+	policy.Deny();
+	for (std::size_t i = 0; i < detail::PolicyUsage::max_metrics; ++i)
+		policy.SetLimit(i, unlimited);
+	GivenPreTestSequence();
+	Compute(1000u);
+	AssertPostTestSequence(false);
+	EXPECT_NE(0u, listener->Usage().metrics[0]);
+}
+
+TEST_F(PerfCounterPolicyTest, should_count_test_thread__if_opened_by_other_thread)
+{
+	bool supported = false;
+	std::thread([&]() { 
+		supported = PerfCounterPolicyListener::IsSupported(); }).join();
+	if (!supported)
+		GTEST_SKIP() << "Hardware performance counters are not available";
+
+	policy.Deny();
+	policy.SetBudget(1000u, unlimited);
+	policy.SetLimit(2u, unlimited);
+	policy.SetLimit(3u, unlimited);
+	GivenPreTestSequence();
+	Compute(100000u);
+	AssertPostTestSequence(true);
+	EXPECT_GE(listener->Usage().metrics[0], 100000u);
+}
+
+TEST_F(PerfCounterPolicyTest, should_only_count__while_denied)
+{
+	if (!PerfCounterPolicyListener::IsSupported())
+		GTEST_SKIP() << "Hardware performance counters are not available";
+
+	policy.Deny();
+	policy.SetBudget(100000u, unlimited);
+	policy.SetLimit(2u, unlimited);
+	policy.SetLimit(3u, unlimited);
+	GivenPreTestSequence();
+	policy.Grant();
+	Compute(1000000u);
+	AssertPostTestSequence(false);
+}
@@ -0,0 +1,155 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+#include "gtest_policies-policy_test.h"
+
+using namespace gtest_policies;
+using namespace gtest_policies::listener;
+
+// Instantiate common test for a policy
+INSTANTIATE_TYPED_TEST_SUITE_P(UpstreamAllocPolicyTest, \
+	PolicyTest, UpstreamAllocPolicyListener);
+
+#ifdef GTEST_POLICY_MEMORY_RESOURCE_AVAILABLE
+
+#include <cstdint>
+#include <vector>
+
+// Upstream resource counting allocations and deallocations forwarded to it
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+	std::size_t allocations = 0u;
+	std::size_t deallocations = 0u;
+
+protected:
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override
+	{
+		++allocations;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void* p, std::size_t bytes, 
+		std::size_t alignment) override
+	{
+		++deallocations;
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+
+	bool do_is_equal(
+		const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+class UpstreamAllocPolicyTest :
+	public PolicyTest<UpstreamAllocPolicyListener> 
+{ 
+public:
+	alignas(std::max_align_t) unsigned char buffer[256];
+	CountingResource upstream;
+};
+
+TEST_F(UpstreamAllocPolicyTest, should_be_denied__by_default)
+{
+	EXPECT_TRUE(policy.IsDenied());
+}
+
+TEST_F(UpstreamAllocPolicyTest, 
+	should_forward_to_upstream__if_allocating_via_policy_memory_resource)
+{
+	policy_memory_resource resource(&upstream);
+	auto p = resource.allocate(64u, 32u);
+	EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(p) % 32u);
+	resource.deallocate(p, 64u, 32u);
+	EXPECT_EQ(&upstream, resource.upstream_resource());
+	EXPECT_EQ(1u, upstream.allocations);
+	EXPECT_EQ(1u, upstream.deallocations);
+}
+
+TEST_F(UpstreamAllocPolicyTest,
+	should_fail_test__if_denied_and_allocating_via_policy_memory_resource)
+{
+	policy_memory_resource resource(&upstream);
+	GivenPreTestSequence();
+	auto p = resource.allocate(64u);
+	EXPECT_NONFATAL_FAILURE(GivenTestEnd(),
+		"Upstream allocations: 1 (budget: 0), bytes: 64 (budget: 0)");
+	EXPECT_TRUE(listener->IsViolated());
+	GivenTestSuiteEnd();
+	GivenTestProgramEnd();
+
+	resource.deallocate(p, 64u);
+}
+
+TEST_F(UpstreamAllocPolicyTest,
+	should_not_fail_test__if_granted_and_allocating_via_policy_memory_resource)
+{
+	policy_memory_resource resource(&upstream);
+	policy.Grant();
+	GivenPreTestSequence();
+	auto p = resource.allocate(64u);
+	AssertPostTestSequence(false);
+
+	resource.deallocate(p, 64u);
+}
+
+TEST_F(UpstreamAllocPolicyTest,
+	should_not_fail_test__if_denied_and_deallocating_via_policy_memory_resource)
+{
+	policy_memory_resource resource(&upstream);
+	auto p = resource.allocate(64u);
+	GivenPreTestSequence();
+	resource.deallocate(p, 64u);
+	AssertPostTestSequence(false);
+}
+
+TEST_F(UpstreamAllocPolicyTest,
+	should_not_fail_test__if_denied_and_allocating_within_budget)
+{
+	policy_memory_resource resource(&upstream);
+	GivenPreTestSequence();
+	policy.SetBudget(1u, 64u);
+	auto p = resource.allocate(64u);
+	AssertPostTestSequence(false);
+
+	resource.deallocate(p, 64u);
+}
+
+TEST_F(UpstreamAllocPolicyTest,
+	should_not_fail_test__if_denied_and_allocations_fit_in_arena)
+{
+	policy_arena_resource arena(buffer, sizeof(buffer), &upstream);
+	GivenPreTestSequence();
+	std::pmr::vector<int> v(&arena);
+	v.reserve(16u);
+	for (int i = 0; i < 16; ++i)
+		v.push_back(i);
+	AssertPostTestSequence(false);
+	EXPECT_EQ(0u, upstream.allocations);
+}
+
+TEST_F(UpstreamAllocPolicyTest,
+	should_fail_test__if_denied_and_arena_falls_back_to_upstream)
+{
+	policy_arena_resource arena(buffer, sizeof(buffer), &upstream);
+	GivenPreTestSequence();
+	std::pmr::vector<int> v(&arena);
+	v.reserve(1024u); // exceeds buffer
+	AssertPostTestSequence(true);
+	EXPECT_EQ(1u, upstream.allocations);
+}
+
+TEST_F(UpstreamAllocPolicyTest,
+	should_release_upstream_memory__if_arena_released)
+{
+	policy_arena_resource arena(buffer, sizeof(buffer), &upstream);
+	EXPECT_NE(nullptr, arena.allocate(1024u));
+	arena.release();
+	EXPECT_EQ(upstream.allocations, upstream.deallocations);
+	EXPECT_EQ(&upstream, arena.upstream_resource());
+}
+
+#endif // GTEST_POLICY_MEMORY_RESOURCE_AVAILABLE
@@ -31,6 +31,13 @@ public:
 		policy.Reset(); 
 	}
 
+	// Policies are global, hence restore defaults so that denials and 
+	// budgets set by a test do not leak into later test suites.
+	void TearDown() override
+	{
+		policy.Reset();
+	}
+
 	::testing::UnitTest* Instance() const
 	{
 		return ::testing::UnitTest::GetInstance();
@@ -111,91 +118,127 @@ TYPED_TEST_SUITE_P(PolicyTest);
 TYPED_TEST_P(PolicyTest,
 	policy__should_inherit_permission__if_set_on_test_program_level)
 {
-	policy.Grant(); // global
-
-	GivenTestProgramStart();
-	ASSERT_FALSE(policy.IsDenied());
-	policy.Deny(); // deny on program level
-	GivenTestSuiteStart();
-	ASSERT_TRUE(policy.IsDenied());
-	GivenTestStart();
-	ASSERT_TRUE(policy.IsDenied());
-	GivenTestEnd();
-	ASSERT_TRUE(policy.IsDenied());
-	GivenTestSuiteEnd();
-	ASSERT_TRUE(policy.IsDenied());
-	GivenTestProgramEnd();
-	ASSERT_FALSE(policy.IsDenied());
+	this->policy.Grant(); // global
+
+	this->GivenTestProgramStart();
+	ASSERT_FALSE(this->policy.IsDenied());
+	this->policy.Deny(); // deny on program level
+	this->GivenTestSuiteStart();
+	ASSERT_TRUE(this->policy.IsDenied());
+	this->GivenTestStart();
+	ASSERT_TRUE(this->policy.IsDenied());
+	this->GivenTestEnd();
+	ASSERT_TRUE(this->policy.IsDenied());
+	this->GivenTestSuiteEnd();
+	ASSERT_TRUE(this->policy.IsDenied());
+	this->GivenTestProgramEnd();
+	ASSERT_FALSE(this->policy.IsDenied());
 }
 
 TYPED_TEST_P(PolicyTest,
 	policy__should_inherit_permission__if_set_on_test_suite_level)
 {
-	policy.Grant(); // global
-
-	GivenTestProgramStart();
-	ASSERT_FALSE(policy.IsDenied());
-	GivenTestSuiteStart();
-	ASSERT_FALSE(policy.IsDenied());
-	policy.Deny();
-	GivenTestStart();
-	ASSERT_TRUE(policy.IsDenied());
-	GivenTestEnd();
-	ASSERT_TRUE(policy.IsDenied());
-	GivenTestSuiteEnd();
-	ASSERT_FALSE(policy.IsDenied());
-	GivenTestProgramEnd();
-	ASSERT_FALSE(policy.IsDenied());
+	this->policy.Grant(); // global
+
+	this->GivenTestProgramStart();
+	ASSERT_FALSE(this->policy.IsDenied());
+	this->GivenTestSuiteStart();
+	ASSERT_FALSE(this->policy.IsDenied());
+	this->policy.Deny();
+	this->GivenTestStart();
+	ASSERT_TRUE(this->policy.IsDenied());
+	this->GivenTestEnd();
+	ASSERT_TRUE(this->policy.IsDenied());
+	this->GivenTestSuiteEnd();
+	ASSERT_FALSE(this->policy.IsDenied());
+	this->GivenTestProgramEnd();
+	ASSERT_FALSE(this->policy.IsDenied());
 }
 
 TYPED_TEST_P(PolicyTest, 
 	policy__should_be_reverted__if_set_on_test_level)
 {
-	policy.Deny(); // global
-
-	ASSERT_TRUE(policy.IsDenied());
-	GivenTestProgramStart();
-	ASSERT_TRUE(policy.IsDenied());
-	GivenTestSuiteStart();
-	ASSERT_TRUE(policy.IsDenied());
-	GivenTestStart();
-	ASSERT_TRUE(policy.IsDenied());
-	policy.Grant();
-	EXPECT_FALSE(policy.IsDenied());
-	GivenTestEnd();
-	ASSERT_TRUE(policy.IsDenied());
-	GivenTestSuiteEnd();
-	ASSERT_TRUE(policy.IsDenied());
-	GivenTestProgramEnd();
-	ASSERT_TRUE(policy.IsDenied());
+	this->policy.Deny(); // global
+
+	ASSERT_TRUE(this->policy.IsDenied());
+	this->GivenTestProgramStart();
+	ASSERT_TRUE(this->policy.IsDenied());
+	this->GivenTestSuiteStart();
+	ASSERT_TRUE(this->policy.IsDenied());
+	this->GivenTestStart();
+	ASSERT_TRUE(this->policy.IsDenied());
+	this->policy.Grant();
+	EXPECT_FALSE(this->policy.IsDenied());
+	this->GivenTestEnd();
+	ASSERT_TRUE(this->policy.IsDenied());
+	this->GivenTestSuiteEnd();
+	ASSERT_TRUE(this->policy.IsDenied());
+	this->GivenTestProgramEnd();
+	ASSERT_TRUE(this->policy.IsDenied());
 }
 
 TYPED_TEST_P(PolicyTest,
 	policy__should_be_reverted__if_set_on_test_suite_level)
 {
-	policy.Deny(); // global
-
-	ASSERT_TRUE(policy.IsDenied());
-	GivenTestProgramStart();
-	ASSERT_TRUE(policy.IsDenied());
-	GivenTestSuiteStart();
-	policy.Grant();
-	ASSERT_FALSE(policy.IsDenied());
-	GivenTestStart();
-	ASSERT_FALSE(policy.IsDenied());
-	GivenTestEnd();
-	ASSERT_FALSE(policy.IsDenied());
-	GivenTestSuiteEnd();
-	ASSERT_TRUE(policy.IsDenied());
-	GivenTestProgramEnd();
-	ASSERT_TRUE(policy.IsDenied());
+	this->policy.Deny(); // global
+
+	ASSERT_TRUE(this->policy.IsDenied());
+	this->GivenTestProgramStart();
+	ASSERT_TRUE(this->policy.IsDenied());
+	this->GivenTestSuiteStart();
+	this->policy.Grant();
+	ASSERT_FALSE(this->policy.IsDenied());
+	this->GivenTestStart();
+	ASSERT_FALSE(this->policy.IsDenied());
+	this->GivenTestEnd();
+	ASSERT_FALSE(this->policy.IsDenied());
+	this->GivenTestSuiteEnd();
+	ASSERT_TRUE(this->policy.IsDenied());
+	this->GivenTestProgramEnd();
+	ASSERT_TRUE(this->policy.IsDenied());
+}
+
+TYPED_TEST_P(PolicyTest,
+	budget__should_be_reverted__if_set_on_test_level)
+{
+	this->policy.SetBudget(1u, 16u); // global
+
+	this->GivenTestProgramStart();
+	this->GivenTestSuiteStart();
+	this->GivenTestStart();
+	this->policy.SetBudget(5u);
+	EXPECT_EQ(5u, this->policy.Limit(0));
+	this->GivenTestEnd();
+	ASSERT_EQ(1u, this->policy.Limit(0));
+	ASSERT_EQ(16u, this->policy.Limit(1));
+	this->GivenTestSuiteEnd();
+	this->GivenTestProgramEnd();
+	ASSERT_EQ(1u, this->policy.Limit(0));
+}
+
+TYPED_TEST_P(PolicyTest,
+	budget__should_be_reverted__if_set_on_test_suite_level)
+{
+	this->GivenTestProgramStart();
+	this->GivenTestSuiteStart();
+	this->policy.SetBudget(2u);
+	this->GivenTestStart();
+	ASSERT_EQ(2u, this->policy.Limit(0));
+	this->GivenTestEnd();
+	ASSERT_EQ(2u, this->policy.Limit(0));
+	this->GivenTestSuiteEnd();
+	ASSERT_EQ(0u, this->policy.Limit(0));
+	this->GivenTestProgramEnd();
+	ASSERT_EQ(0u, this->policy.Limit(0));
 }
 
 REGISTER_TYPED_TEST_SUITE_P(PolicyTest, \
 	policy__should_inherit_permission__if_set_on_test_program_level, \
 	policy__should_inherit_permission__if_set_on_test_suite_level, \
 	policy__should_be_reverted__if_set_on_test_level, \
-	policy__should_be_reverted__if_set_on_test_suite_level);
+	policy__should_be_reverted__if_set_on_test_suite_level, \
+	budget__should_be_reverted__if_set_on_test_level, \
+	budget__should_be_reverted__if_set_on_test_suite_level);
 
 
 #endif // GTEST_POLICY_POLICY_TEST_H
\ No newline at end of file
@@ -0,0 +1,99 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+#include <gtest/gtest.h>
+#include <gtest/gtest-spi.h> // enables testing test failures
+
+#include <gtest_policies/gtest_policies.h>
+
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+using namespace gtest_policies;
+using namespace gtest_policies::listener;
+
+TEST(ReportBufferTest, should_be_empty__if_default_constructed)
+{
+	std::unique_ptr<detail::ReportBuffer> report(new detail::ReportBuffer());
+	EXPECT_STREQ("", report->c_str());
+	EXPECT_EQ(0u, report->size());
+	EXPECT_FALSE(report->truncated());
+}
+
+TEST(ReportBufferTest, should_format_text_and_numbers)
+{
+	std::unique_ptr<detail::ReportBuffer> report(new detail::ReportBuffer());
+	*report << "Calls: " << 0u << ", " << 42ull << ", " << -7 << ", " 
+		<< std::string("budget: ") << detail::FormatLimit(3u) << '/' 
+		<< detail::FormatLimit(unlimited) << ", max: " << unlimited - 1u;
+	EXPECT_STREQ("Calls: 0, 42, -7, budget: 3/unlimited, "
+		"max: 18446744073709551614", report->c_str());
+}
+
+TEST(ReportBufferTest, should_truncate_with_ellipsis__if_exceeding_capacity)
+{
+	std::unique_ptr<detail::ReportBuffer> report(new detail::ReportBuffer());
+	const std::string text(detail::ReportBuffer::capacity, 'x');
+	*report << text << "not appended";
+	EXPECT_TRUE(report->truncated());
+	EXPECT_EQ(detail::ReportBuffer::capacity - 1u, report->size());
+	EXPECT_EQ(report->size(), std::strlen(report->c_str()));
+	EXPECT_STREQ("x...", report->c_str() + report->size() - 4u);
+}
+
+TEST(ReportBufferTest, should_be_empty__if_cleared)
+{
+	std::unique_ptr<detail::ReportBuffer> report(new detail::ReportBuffer());
+	*report << "text";
+	report->Clear();
+	EXPECT_STREQ("", report->c_str());
+}
+
+TEST(ViolationReportTest, should_not_account_reporting_to_test__if_other_policy_monitors_memory)
+{
+	const auto& unit_test = *::testing::UnitTest::GetInstance();
+	const auto& test_info = *unit_test.current_test_info();
+	dynamic_memory_allocation.Reset();
+	standard_output.Reset();
+	dynamic_memory_allocation.Deny();
+	standard_output.Deny();
+	std::unique_ptr<MemAllocPolicyListener> alloc(new MemAllocPolicyListener());
+	std::unique_ptr<StdOutPolicyListener> out(new StdOutPolicyListener());
+
+	// Intercept failures without allocating while memory is monitored
+	::testing::TestPartResultArray results;
+	{
+		::testing::ScopedFakeTestPartResultReporter reporter(
+			::testing::ScopedFakeTestPartResultReporter::
+				INTERCEPT_ONLY_CURRENT_THREAD, &results);
+		alloc->OnTestProgramStart(unit_test);
+		out->OnTestProgramStart(unit_test);
+		alloc->OnTestSuiteStart(*unit_test.current_test_suite());
+		out->OnTestSuiteStart(*unit_test.current_test_suite());
+		alloc->OnTestStart(test_info);
+		out->OnTestStart(test_info);
+		gtest_policies::Apply();
+
+		std::cout << "x";
+
+		// Google Test invokes listeners in reverse order at end of test
+		out->OnTestEnd(test_info);
+		alloc->OnTestEnd(test_info);
+		out->OnTestSuiteEnd(*unit_test.current_test_suite());
+		alloc->OnTestSuiteEnd(*unit_test.current_test_suite());
+		out->OnTestProgramEnd(unit_test);
+		alloc->OnTestProgramEnd(unit_test);
+	}
+	std::cout << std::endl;
+	dynamic_memory_allocation.Reset();
+	standard_output.Reset();
+
+	EXPECT_TRUE(out->IsViolated());
+	EXPECT_FALSE(alloc->IsViolated());
+	ASSERT_EQ(1, results.size());
+	EXPECT_NE(nullptr, std::strstr(results.GetTestPartResult(0).message(), 
+		"Policy violation: gtest_policy::cxx_std_out"));
+}
@@ -0,0 +1,122 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+#include "gtest_policies-policy_test.h"
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <sys/mman.h> // mmap
+#endif
+
+using namespace gtest_policies;
+using namespace gtest_policies::listener;
+
+// Instantiate common test for a policy
+INSTANTIATE_TYPED_TEST_SUITE_P(ResourceUsagePolicyTest, \
+	PolicyTest, ResourceUsagePolicyListener);
+
+class ResourceUsagePolicyTest :
+	public PolicyTest<ResourceUsagePolicyListener> 
+{ 
+protected:
+	void GivenUnlimitedBudget()
+	{
+		for (std::size_t i = 0; i < detail::PolicyUsage::max_metrics; ++i)
+			policy.SetLimit(i, unlimited);
+	}
+};
+
+TEST_F(ResourceUsagePolicyTest, should_be_granted__by_default)
+{
+	EXPECT_FALSE(policy.IsDenied());
+	GivenPreTestSequence();
+	std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	AssertPostTestSequence(false);
+}
+
+TEST_F(ResourceUsagePolicyTest, should_not_fail_test__if_denied_and_within_budget)
+{
+	policy.Deny();
+	GivenUnlimitedBudget();
+	GivenPreTestSequence();
+	std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	AssertPostTestSequence(false);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+namespace
+{
+	// Touches pages of a fresh anonymous mapping, each causing a minor fault
+	void TouchFreshPages(std::size_t pages)
+	{
+		const std::size_t size = pages * 4096u;
+		void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, 
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		ASSERT_NE(MAP_FAILED, p);
+		volatile char* bytes = static_cast<volatile char*>(p);
+		for (std::size_t i = 0; i < size; i += 4096u)
+			bytes[i] = 1;
+		munmap(p, size);
+	}
+}
+
+TEST_F(ResourceUsagePolicyTest, should_fail_test__if_denied_and_touching_fresh_pages)
+{
+	policy.Deny();
+	GivenUnlimitedBudget();
+	policy.SetLimit(0u, 8u);
+	GivenPreTestSequence();
+	TouchFreshPages(64u);
+	AssertPostTestSequence(true);
+	EXPECT_GE(listener->Usage().metrics[0], 64u);
+}
+
+TEST_F(ResourceUsagePolicyTest, should_not_fail_test__if_granted_and_touching_fresh_pages)
+{
+	policy.Grant();
+	GivenPreTestSequence();
+	TouchFreshPages(64u);
+	AssertPostTestSequence(false);
+}
+
+TEST_F(ResourceUsagePolicyTest, should_only_count_page_faults__while_denied)
+{
+	policy.Deny();
+	GivenUnlimitedBudget();
+	policy.SetLimit(0u, 32u);
+	GivenPreTestSequence();
+	policy.Grant();
+	TouchFreshPages(64u);
+	AssertPostTestSequence(false);
+}
+
+TEST_F(ResourceUsagePolicyTest, should_fail_test__if_denied_and_sleeping)
+{
+	policy.Deny();
+	GivenUnlimitedBudget();
+	policy.SetLimit(2u, 0u);
+	GivenPreTestSequence();
+	std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	AssertPostTestSequence(true);
+	EXPECT_GE(listener->Usage().metrics[2], 1u);
+}
+
+TEST_F(ResourceUsagePolicyTest, should_report_deltas__if_violated)
+{
+	policy.Deny();
+	GivenUnlimitedBudget();
+	policy.SetLimit(0u, 8u);
+	GivenPreTestSequence();
+	TouchFreshPages(64u);
+	EXPECT_NONFATAL_FAILURE(GivenTestEnd(), "(budget: 8), major page faults: ");
+	GivenTestSuiteEnd();
+	GivenTestProgramEnd();
+}
+
+#endif // defined(__unix__) || defined(__APPLE__)
@@ -0,0 +1,118 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+#include "gtest_policies-policy_test.h"
+
+using namespace gtest_policies;
+using namespace gtest_policies::listener;
+
+// Instantiate common test for a policy
+INSTANTIATE_TYPED_TEST_SUITE_P(ThreadPolicyTest, \
+	PolicyTest, ThreadPolicyListener);
+
+#if defined(__GLIBC__) && defined(__LP64__)
+
+#include <atomic>
+#include <future>
+#include <thread>
+
+class ThreadPolicyTest :
+	public PolicyTest<ThreadPolicyListener> { };
+
+TEST_F(ThreadPolicyTest, should_be_granted__by_default)
+{
+	EXPECT_FALSE(policy.IsDenied());
+	GivenPreTestSequence();
+	std::thread([]() { }).join();
+	AssertPostTestSequence(false);
+}
+
+TEST_F(ThreadPolicyTest, should_not_fail_test__if_denied_and_not_creating_threads)
+{
+	policy.Deny();
+	GivenPreTestSequence();
+	AssertPostTestSequence(false);
+}
+
+TEST_F(ThreadPolicyTest, should_fail_test__if_denied_and_creating_thread)
+{
+	policy.Deny();
+	GivenPreTestSequence();
+	std::thread([]() { }).join();
+	AssertPostTestSequence(true);
+	EXPECT_EQ(1u, listener->Usage().metrics[0]);
+	EXPECT_EQ(0u, listener->Usage().metrics[1]);
+}
+
+TEST_F(ThreadPolicyTest, should_fail_test__if_denied_and_launching_async_task)
+{
+	policy.Deny();
+	GivenPreTestSequence();
+	std::async(std::launch::async, []() { return 1; }).get();
+	AssertPostTestSequence(true);
+}
+
+TEST_F(ThreadPolicyTest, should_report_call_site__if_denied_and_creating_thread)
+{
+	policy.Deny();
+	GivenPreTestSequence();
+	std::thread([]() { }).join();
+	policy.Grant();
+	EXPECT_NONFATAL_FAILURE(GivenTestEnd(), 
+		"Threads created: 1 (budget: 0), threads alive at end of test: 0 "
+		"(budget: 0). \nTop 1 of 1 thread creation call site(s):\n"
+		"#1: 1 thread creation(s)\n");
+	GivenTestSuiteEnd();
+	GivenTestProgramEnd();
+}
+
+TEST_F(ThreadPolicyTest, should_not_fail_test__if_denied_and_joining_threads_within_budget)
+{
+	policy.Deny();
+	policy.SetBudget(2u, 0u);
+	GivenPreTestSequence();
+	std::thread first([]() { });
+	std::thread second([]() { });
+	first.join();
+	second.join();
+	AssertPostTestSequence(false);
+}
+
+TEST_F(ThreadPolicyTest, should_fail_test__if_denied_and_thread_alive_at_end_of_test)
+{
+	std::atomic<bool> done(false);
+	policy.Deny();
+	policy.SetBudget(unlimited, 0u);
+	GivenPreTestSequence();
+	std::thread worker([&]() { while (!done.load()) { } });
+	AssertPostTestSequence(true);
+	EXPECT_EQ(1u, listener->Usage().metrics[1]);
+
+	done.store(true);
+	worker.join();
+}
+
+TEST_F(ThreadPolicyTest, should_fail_test__if_granted_and_thread_alive_at_end_of_test)
+{
+	std::atomic<bool> done(false);
+	policy.Deny();
+	policy.SetBudget(unlimited, 0u);
+	GivenPreTestSequence();
+	policy.Grant();
+	std::thread worker([&]() { while (!done.load()) { } });
+	AssertPostTestSequence(true);
+
+	done.store(true);
+	worker.join();
+}
+
+TEST_F(ThreadPolicyTest, should_not_fail_test__if_granted_and_creating_thread)
+{
+	policy.Grant();
+	GivenPreTestSequence();
+	std::thread([]() { }).join();
+	AssertPostTestSequence(false);
+}
+
+#endif // defined(__GLIBC__) && defined(__LP64__)
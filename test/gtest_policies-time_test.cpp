@@ -0,0 +1,144 @@
+// Copyright(C) 2019 - 2020 Hkan Sidenvall <ekcoh.git@gmail.com>.
+// This file is subject to the license terms in the LICENSE file found in the 
+// root directory of this distribution.
+
+#include "gtest_policies-policy_test.h"
+
+#include <chrono>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+using namespace gtest_policies;
+using namespace gtest_policies::listener;
+
+namespace
+{
+	void Sleep(std::chrono::milliseconds duration)
+	{
+		std::this_thread::sleep_for(duration);
+	}
+
+	void Spin(std::chrono::milliseconds duration)
+	{
+		const auto end = std::chrono::steady_clock::now() + duration;
+		volatile unsigned counter = 0u;
+		while (std::chrono::steady_clock::now() < end)
+			counter = counter + 1u;
+	}
+
+	template<class Context, class = void>
+	struct AcceptsDurationBudget : std::false_type { };
+
+	template<class Context>
+	struct AcceptsDurationBudget<Context, decltype(
+		std::declval<Context&>().SetBudget(std::chrono::seconds(1)))> : 
+		std::true_type { };
+}
+
+// Instantiate common test for a policy
+INSTANTIATE_TYPED_TEST_SUITE_P(ExecTimePolicyTest, \
+	PolicyTest, ExecTimePolicyListener);
+
+class ExecTimePolicyTest :
+	public PolicyTest<ExecTimePolicyListener> { };
+
+TEST_F(ExecTimePolicyTest, should_only_accept_duration_budget__if_time_policy)
+{
+	static_assert(AcceptsDurationBudget<TimePolicyContext>::value, 
+		"execution time budget is a duration");
+	static_assert(!AcceptsDurationBudget<PolicyContext>::value, 
+		"count based budget must not accept a duration");
+	static_assert(std::is_same<decltype(execution_time), 
+		TimePolicyContext>::value, "execution_time is a time policy");
+}
+
+TEST_F(ExecTimePolicyTest, should_be_granted__by_default)
+{
+	EXPECT_FALSE(policy.IsDenied());
+	GivenPreTestSequence();
+	Sleep(std::chrono::milliseconds(1));
+	AssertPostTestSequence(false);
+}
+
+TEST_F(ExecTimePolicyTest, should_fail_test__if_denied_without_budget)
+{
+	policy.Deny();
+	GivenPreTestSequence();
+	Sleep(std::chrono::milliseconds(1));
+	AssertPostTestSequence(true);
+}
+
+TEST_F(ExecTimePolicyTest, should_not_fail_test__if_denied_and_within_budget)
+{
+	policy.Deny();
+	execution_time.SetBudget(std::chrono::seconds(60));
+	GivenPreTestSequence();
+	Sleep(std::chrono::milliseconds(1));
+	AssertPostTestSequence(false);
+}
+
+TEST_F(ExecTimePolicyTest, should_fail_test__if_denied_and_exceeding_wall_time_budget)
+{
+	policy.Deny();
+	execution_time.SetBudget(std::chrono::milliseconds(1));
+	GivenPreTestSequence();
+	Sleep(std::chrono::milliseconds(20));
+	AssertPostTestSequence(true);
+	EXPECT_GE(listener->Usage().metrics[0], 20000000u);
+}
+
+TEST_F(ExecTimePolicyTest, should_not_fail_test__if_granted_and_exceeding_wall_time_budget)
+{
+	policy.Grant();
+	execution_time.SetBudget(std::chrono::milliseconds(1));
+	GivenPreTestSequence();
+	Sleep(std::chrono::milliseconds(20));
+	AssertPostTestSequence(false);
+}
+
+TEST_F(ExecTimePolicyTest, should_only_measure_time__while_denied)
+{
+	policy.Deny();
+	execution_time.SetBudget(std::chrono::milliseconds(10));
+	GivenPreTestSequence();
+	policy.Grant();
+	Sleep(std::chrono::milliseconds(20));
+	AssertPostTestSequence(false);
+}
+
+TEST_F(ExecTimePolicyTest, should_report_wall_time__if_violated)
+{
+	policy.Deny();
+	execution_time.SetBudget(std::chrono::milliseconds(1));
+	GivenPreTestSequence();
+	Sleep(std::chrono::milliseconds(5));
+	EXPECT_NONFATAL_FAILURE(GivenTestEnd(), "(budget: 1.000 ms), CPU time: ");
+	GivenTestSuiteEnd();
+	GivenTestProgramEnd();
+}
+
+#if !defined(_WIN32)
+
+TEST_F(ExecTimePolicyTest, should_fail_test__if_denied_and_exceeding_cpu_time_budget)
+{
+	policy.Deny();
+	execution_time.SetBudget(std::chrono::nanoseconds::max(), 
+		std::chrono::milliseconds(1));
+	GivenPreTestSequence();
+	Spin(std::chrono::milliseconds(20));
+	AssertPostTestSequence(true);
+}
+
+TEST_F(ExecTimePolicyTest, should_not_fail_test__if_sleeping_within_cpu_time_budget)
+{
+	policy.Deny();
+	execution_time.SetBudget(std::chrono::nanoseconds::max(), 
+		std::chrono::milliseconds(10));
+	GivenPreTestSequence();
+	Sleep(std::chrono::milliseconds(20));
+	AssertPostTestSequence(false);
+	EXPECT_GE(listener->Usage().metrics[0], 20000000u);
+}
+
+#endif // !defined(_WIN32)